@@ -1,11 +1,14 @@
+#define _GNU_SOURCE
 #include "compressor.h"
 #include "utils.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <errno.h>
+#include <time.h>
 
 // Función para obtener el número de CPUs
 int get_cpu_count(void) {
@@ -13,6 +16,134 @@ int get_cpu_count(void) {
     return (cpus > 0) ? cpus : DEFAULT_THREADS;
 }
 
+// Opciones por defecto (equivalentes a la línea de comandos sin flags)
+void parzip_default_options(parzip_options_t *opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->threads = get_cpu_count();
+    opts->block_size = DEFAULT_BLOCK_SIZE;
+    opts->compression_level = Z_DEFAULT_COMPRESSION;
+}
+
+int is_parzip_magic(uint64_t magic) {
+    return magic == MAGIC_NUMBER || magic == MAGIC_NUMBER_V2;
+}
+
+// Flags del header (los archivos de la versión 1 no tienen el campo inicializado)
+uint32_t parzip_flags(const parzip_header_t *header) {
+    return header->magic == MAGIC_NUMBER_V2 ? header->flags : 0;
+}
+
+// Offset donde empiezan los datos: header, tabla de bloques y tabla de hashes opcional
+uint64_t parzip_data_offset(const parzip_header_t *header) {
+    uint64_t offset = sizeof(parzip_header_t) + (uint64_t)header->num_blocks * sizeof(block_info_t);
+    if (parzip_flags(header) & PARZIP_FLAG_BLOCK_HASHES) {
+        offset += (uint64_t)header->num_blocks * sizeof(block_digest_t);
+    }
+    if (parzip_flags(header) & PARZIP_FLAG_PARTIAL) {
+        offset += sizeof(parzip_shard_info_t);
+    }
+    return offset;
+}
+
+// Marca como BLOCK_FLAG_ZERO los bloques que caen enteros en huecos del archivo
+// (SEEK_DATA/SEEK_HOLE), de modo que no hace falta leerlos. Devuelve cuántos marcó.
+uint32_t mark_hole_blocks(int fd, const parzip_header_t *header, block_info_t *block_infos) {
+    uint64_t size = header->original_size;
+    uint64_t block_size = header->block_size;
+    uint64_t pos = 0;
+    uint32_t marked = 0;
+    
+    while (pos < size) {
+        off_t data = lseek(fd, pos, SEEK_DATA);
+        if (data < 0) {
+            if (errno != ENXIO) break; // Sin soporte: tratar todo como datos
+            data = size;               // Hueco hasta el final del archivo
+        }
+        
+        // Bloques completamente contenidos en el hueco [pos, data)
+        for (uint64_t i = (pos + block_size - 1) / block_size; i < header->num_blocks && i * block_size < (uint64_t)data; i++) {
+            uint64_t end = i * block_size + block_size < size ? i * block_size + block_size : size;
+            if (end > (uint64_t)data) break;
+            block_infos[i].flags |= BLOCK_FLAG_ZERO;
+            marked++;
+        }
+        
+        if ((uint64_t)data >= size) break;
+        off_t hole = lseek(fd, data, SEEK_HOLE);
+        if (hole < 0) break;
+        pos = hole;
+    }
+    return marked;
+}
+
+// Calcula tamaño original y offset reservado de cada bloque del archivo .pz
+// (con alignment > 1 cada región reservada empieza y termina alineada, para O_DIRECT)
+void plan_parzip_blocks(const parzip_header_t *header, block_info_t *block_infos, uint32_t alignment) {
+    uint64_t current_offset = ALIGN_UP(parzip_data_offset(header), alignment);
+    uint64_t remaining = header->original_size;
+    
+    for (uint32_t i = 0; i < header->num_blocks; i++) {
+        block_infos[i].block_id = i;
+        block_infos[i].original_size = remaining < header->block_size ? (uint32_t)remaining : header->block_size;
+        block_infos[i].offset = current_offset;
+        remaining -= block_infos[i].original_size;
+        
+        // Los bloques de ceros ya conocidos y los de otros fragmentos no necesitan espacio reservado
+        if (!(block_infos[i].flags & (BLOCK_FLAG_ZERO | BLOCK_FLAG_ABSENT))) {
+            current_offset += ALIGN_UP(compressBound(block_infos[i].original_size), alignment);
+        }
+    }
+}
+
+// Nivel efectivo (Z_DEFAULT_COMPRESSION equivale al nivel 6 de zlib)
+static int effective_level(int level) {
+    return level == Z_DEFAULT_COMPRESSION ? 6 : level;
+}
+
+static double elapsed_seconds(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void rate_controller_init(rate_controller_t *rc, double target_rate, int threads, int initial_level) {
+    memset(rc, 0, sizeof(*rc));
+    pthread_mutex_init(&rc->mutex, NULL);
+    rc->target_rate = target_rate;
+    rc->threads = threads;
+    rc->level = effective_level(initial_level);
+}
+
+static int rate_controller_level(rate_controller_t *rc) {
+    pthread_mutex_lock(&rc->mutex);
+    int level = rc->level;
+    pthread_mutex_unlock(&rc->mutex);
+    return level;
+}
+
+// Registrar el throughput de un bloque y ajustar el nivel un paso: bajar si la media
+// móvil no alcanza el objetivo, subir si lo supera (con margen de histéresis del 5%)
+static void rate_controller_update(rate_controller_t *rc, uint32_t bytes, double seconds) {
+    pthread_mutex_lock(&rc->mutex);
+    
+    // Bytes y tiempo se promedian por separado: así los bloques rápidos no inflan la media
+    rc->recent_bytes = 0.7 * rc->recent_bytes + 0.3 * bytes;
+    rc->recent_seconds = 0.7 * rc->recent_seconds + 0.3 * seconds;
+    double rate = rc->recent_bytes / (rc->recent_seconds > 1e-9 ? rc->recent_seconds : 1e-9) / 1e6 * rc->threads;
+    
+    // Esperar a que la media refleje el nivel actual antes de volver a moverlo
+    if (++rc->blocks_since_change >= (rc->threads > 2 ? rc->threads : 2)) {
+        if (rate < rc->target_rate * 0.95 && rc->level > 0) {
+            rc->level--;
+            rc->blocks_since_change = 0;
+        } else if (rate > rc->target_rate * 1.05 && rc->level < 9) {
+            rc->level++;
+            rc->blocks_since_change = 0;
+        }
+    }
+    pthread_mutex_unlock(&rc->mutex);
+}
+
 // Función del hilo para comprimir un bloque
 void* compress_block_thread(void* arg) {
     thread_data_t *data = (thread_data_t*)arg;
@@ -20,62 +151,139 @@ void* compress_block_thread(void* arg) {
     unsigned char *input_buffer = NULL;
     unsigned char *output_buffer = NULL;
     uLongf compressed_size;
+    uLong bound = compressBound(data->actual_size);
     int result = Z_OK;
+    struct timespec start;
     
-    // Abrir archivo de entrada
-    input_fp = fopen(data->input_file, "rb");
-    if (!input_fp) {
-        fprintf(stderr, "Error: No se pudo abrir el archivo de entrada en hilo %d\n", data->thread_id);
-        *data->error_flag = 1;
-        return NULL;
-    }
-    
-    // Allocar buffers
-    input_buffer = malloc(data->actual_size);
-    output_buffer = malloc(compressBound(data->actual_size));
+    // Con --target-rate cada bloque usa el nivel que decide el controlador
+    int level = data->rate_controller ? rate_controller_level(data->rate_controller) : data->compression_level;
+    clock_gettime(CLOCK_MONOTONIC, &start);
     
-    if (!input_buffer || !output_buffer) {
-        fprintf(stderr, "Error: No se pudo allocar memoria en hilo %d\n", data->thread_id);
-        *data->error_flag = 1;
-        goto cleanup;
+    if (data->direct_io) {
+        // Modo directo: buffers alineados y lectura posicional sobre el descriptor compartido
+        input_buffer = alloc_aligned(ALIGN_UP(data->actual_size, DIRECT_IO_ALIGN));
+        output_buffer = alloc_aligned(ALIGN_UP(bound, DIRECT_IO_ALIGN));
+        
+        if (!input_buffer || !output_buffer) {
+            fprintf(stderr, "Error: No se pudo allocar memoria en hilo %d\n", data->thread_id);
+            *data->error_flag = 1;
+            goto cleanup;
+        }
+        
+        ssize_t bytes_read = pread_direct(data->input_fd, input_buffer, ALIGN_UP(data->actual_size, DIRECT_IO_ALIGN), data->file_offset);
+        if (bytes_read < (ssize_t)data->actual_size) {
+            fprintf(stderr, "Error: No se pudo leer el bloque completo en hilo %d\n", data->thread_id);
+            *data->error_flag = 1;
+            goto cleanup;
+        }
+    } else {
+        // Abrir archivo de entrada
+        input_fp = fopen(data->input_file, "rb");
+        if (!input_fp) {
+            fprintf(stderr, "Error: No se pudo abrir el archivo de entrada en hilo %d\n", data->thread_id);
+            *data->error_flag = 1;
+            return NULL;
+        }
+        
+        // Allocar buffers
+        input_buffer = malloc(data->actual_size);
+        output_buffer = malloc(bound);
+        
+        if (!input_buffer || !output_buffer) {
+            fprintf(stderr, "Error: No se pudo allocar memoria en hilo %d\n", data->thread_id);
+            *data->error_flag = 1;
+            goto cleanup;
+        }
+        
+        // Leer bloque desde el archivo
+        fseek(input_fp, data->file_offset, SEEK_SET);
+        size_t bytes_read = fread(input_buffer, 1, data->actual_size, input_fp);
+        if (bytes_read != data->actual_size) {
+            fprintf(stderr, "Error: No se pudo leer el bloque completo en hilo %d\n", data->thread_id);
+            *data->error_flag = 1;
+            goto cleanup;
+        }
     }
     
-    // Leer bloque desde el archivo
-    fseek(input_fp, data->file_offset, SEEK_SET);
-    size_t bytes_read = fread(input_buffer, 1, data->actual_size, input_fp);
-    if (bytes_read != data->actual_size) {
-        fprintf(stderr, "Error: No se pudo leer el bloque completo en hilo %d\n", data->thread_id);
-        *data->error_flag = 1;
+    // Bloque de ceros: se registra en la tabla sin escribir datos
+    if (is_zero_block(input_buffer, data->actual_size)) {
+        data->block_info->flags |= BLOCK_FLAG_ZERO;
+        data->block_info->compressed_size = 0;
+        printf("⚪ Bloque %d: %d bytes de ceros (sin datos)\n", data->block_id, data->actual_size);
         goto cleanup;
     }
     
-    // Comprimir el bloque
-    compressed_size = compressBound(data->actual_size);
-    result = compress2(output_buffer, &compressed_size, input_buffer, data->actual_size, data->compression_level);
+    // Digest del contenido: permite reutilizar el bloque al re-archivar con --base
+    block_digest(input_buffer, data->actual_size, data->block_hash);
     
-    if (result != Z_OK) {
-        fprintf(stderr, "Error: Fallo en compresión del bloque %d en hilo %d\n", data->block_id, data->thread_id);
-        *data->error_flag = 1;
-        goto cleanup;
+    int reused = data->base_info && memcmp(data->base_hash, data->block_hash, sizeof(block_digest_t)) == 0 &&
+                 data->base_info->original_size == data->actual_size &&
+                 !(data->base_info->flags & BLOCK_FLAG_ZERO) &&
+                 data->base_info->compressed_size <= bound;
+    
+    if (reused) {
+        // Bloque sin cambios: copiar los datos comprimidos de la base sin descomprimirlos
+        compressed_size = data->base_info->compressed_size;
+        if (pread_full(data->base_fd, output_buffer, compressed_size, data->base_info->offset) != (ssize_t)compressed_size) {
+            fprintf(stderr, "Error: No se pudo leer el bloque %d del archivo base\n", data->block_id);
+            *data->error_flag = 1;
+            goto cleanup;
+        }
+        data->block_info->level = data->base_info->level;
+    } else {
+        // Comprimir el bloque
+        compressed_size = bound;
+        result = compress2(output_buffer, &compressed_size, input_buffer, data->actual_size, level);
+        
+        if (result != Z_OK) {
+            fprintf(stderr, "Error: Fallo en compresión del bloque %d en hilo %d\n", data->block_id, data->thread_id);
+            *data->error_flag = 1;
+            goto cleanup;
+        }
+        
+        data->block_info->level = effective_level(level);
+        if (data->rate_controller) {
+            rate_controller_update(data->rate_controller, data->actual_size, elapsed_seconds(&start));
+        }
+    }
+    
+    // En modo directo se escribe la región reservada completa (alineada y rellenada con ceros)
+    int write_failed = 0;
+    if (data->direct_io) {
+        size_t padded_size = ALIGN_UP(compressed_size, DIRECT_IO_ALIGN);
+        memset(output_buffer + compressed_size, 0, padded_size - compressed_size);
+        write_failed = pwrite_full(data->output_fd, output_buffer, padded_size, data->block_info->offset) != 0;
     }
     
     // Escribir bloque comprimido al archivo de salida (con mutex)
     pthread_mutex_lock(data->output_mutex);
     
-    // Buscar la posición correcta en el archivo
-    fseek(data->output_fp, data->block_info->offset, SEEK_SET);
+    if (!data->direct_io) {
+        // Buscar la posición correcta en el archivo
+        fseek(data->output_fp, data->block_info->offset, SEEK_SET);
+        
+        // Escribir datos comprimidos
+        size_t written = fwrite(output_buffer, 1, compressed_size, data->output_fp);
+        write_failed = written != compressed_size;
+    }
     
-    // Escribir datos comprimidos
-    size_t written = fwrite(output_buffer, 1, compressed_size, data->output_fp);
-    if (written != compressed_size) {
+    if (write_failed) {
         fprintf(stderr, "Error: No se pudo escribir el bloque comprimido %d\n", data->block_id);
         *data->error_flag = 1;
     } else {
         // Actualizar información del bloque
         data->block_info->compressed_size = compressed_size;
-        printf("✅ Bloque %d comprimido: %d -> %d bytes (%.1f%% reducción)\n", 
-               data->block_id, data->actual_size, (int)compressed_size,
-               100.0 * (1.0 - (double)compressed_size / data->actual_size));
+        if (reused) {
+            printf("♻️ Bloque %d sin cambios: %d bytes copiados de la base\n", data->block_id, (int)compressed_size);
+        } else if (data->rate_controller) {
+            printf("✅ Bloque %d comprimido (nivel %d): %d -> %d bytes (%.1f%% reducción)\n", 
+                   data->block_id, data->block_info->level, data->actual_size, (int)compressed_size,
+                   100.0 * (1.0 - (double)compressed_size / data->actual_size));
+        } else {
+            printf("✅ Bloque %d comprimido: %d -> %d bytes (%.1f%% reducción)\n", 
+                   data->block_id, data->actual_size, (int)compressed_size,
+                   100.0 * (1.0 - (double)compressed_size / data->actual_size));
+        }
     }
     
     pthread_mutex_unlock(data->output_mutex);
@@ -89,10 +297,118 @@ cleanup:
 
 // Función principal de compresión
 int compress_file(const char *input_file, const char *output_file, int threads, int block_size, int compression_level) {
+    parzip_options_t opts;
+    parzip_default_options(&opts);
+    opts.threads = threads;
+    opts.block_size = block_size;
+    opts.compression_level = compression_level;
+    return compress_file_ex(input_file, output_file, &opts);
+}
+
+// Abrir entrada y salida con O_DIRECT; devuelve 1 si el sistema de archivos no lo soporta
+static int open_direct_pair(const char *input_file, const char *output_file, int *input_fd, int *output_fd) {
+    *input_fd = open_direct(input_file, O_RDONLY);
+    *output_fd = (*input_fd >= 0) ? open_direct(output_file, O_WRONLY | O_CREAT | O_TRUNC) : -1;
+    if (*input_fd >= 0 && *output_fd >= 0) return 0;
+    
+    int err = errno;
+    if (*input_fd >= 0) close(*input_fd);
+    *input_fd = *output_fd = -1;
+    if (err == EINVAL) {
+        printf("⚠️  O_DIRECT no soportado por el sistema de archivos, usando E/S con buffer\n");
+        return 1;
+    }
+    fprintf(stderr, "Error: No se pudieron abrir los archivos en modo directo: %s\n", strerror(err));
+    return -1;
+}
+
+// Cargar header, tabla de bloques y hashes del archivo .pz usado como base (--base)
+static int load_base_archive(const char *base_file, parzip_header_t *header, block_info_t **block_infos, block_digest_t **block_hashes) {
+    int result = -1;
+    FILE *fp = fopen(base_file, "rb");
+    if (!fp) {
+        fprintf(stderr, "Error: No se pudo abrir el archivo base: %s\n", base_file);
+        return -1;
+    }
+    
+    if (read_parzip_header(fp, header) != 0 || !is_parzip_magic(header->magic)) {
+        fprintf(stderr, "Error: El archivo base '%s' no es un archivo .pz válido\n", base_file);
+        goto done;
+    }
+    if (!(parzip_flags(header) & PARZIP_FLAG_BLOCK_HASHES)) {
+        fprintf(stderr, "Error: El archivo base no tiene hashes por bloque (vuelva a crearlo con esta versión)\n");
+        goto done;
+    }
+    
+    *block_infos = calloc(header->num_blocks ? header->num_blocks : 1, sizeof(block_info_t));
+    *block_hashes = calloc(header->num_blocks ? header->num_blocks : 1, sizeof(block_digest_t));
+    if (!*block_infos || !*block_hashes || read_parzip_tables(fp, header, *block_infos, *block_hashes) != 0) {
+        fprintf(stderr, "Error: No se pudo leer la tabla de bloques del archivo base\n");
+        goto done;
+    }
+    result = 0;
+    
+done:
+    fclose(fp);
+    return result;
+}
+
+// Huella del archivo original de un fragmento: SHA-256 del tamaño y de SHARD_FINGERPRINT_SAMPLES
+// trozos repartidos por todo el archivo, del inicio al final. Todos los fragmentos la calculan
+// igual sin leer el archivo completo, y --merge rechaza fragmentos de archivos distintos.
+static int shard_fingerprint(const char *input_file, uint64_t file_size, block_digest_t *fingerprint) {
+    struct {
+        uint64_t size;
+        block_digest_t samples[SHARD_FINGERPRINT_SAMPLES];
+    } summary;
+    size_t chunk_size = file_size < SHARD_FINGERPRINT_CHUNK ? (size_t)file_size : SHARD_FINGERPRINT_CHUNK;
+    unsigned char *chunk = malloc(chunk_size ? chunk_size : 1);
+    int fd = open(input_file, O_RDONLY | O_CLOEXEC);
+    int result = 0;
+    
+    if (!chunk || fd < 0) {
+        result = -1;
+        goto cleanup;
+    }
+    
+    memset(&summary, 0, sizeof(summary));
+    summary.size = file_size;
+    for (int s = 0; s < SHARD_FINGERPRINT_SAMPLES; s++) {
+        uint64_t offset = (file_size - chunk_size) * s / (SHARD_FINGERPRINT_SAMPLES - 1);
+        if (pread_full(fd, chunk, chunk_size, offset) != (ssize_t)chunk_size) {
+            result = -1;
+            goto cleanup;
+        }
+        block_digest(chunk, chunk_size, &summary.samples[s]);
+    }
+    block_digest((const unsigned char*)&summary, sizeof(summary), fingerprint);
+    
+cleanup:
+    if (fd >= 0) close(fd);
+    if (chunk) free(chunk);
+    return result;
+}
+
+int compress_file_ex(const char *input_file, const char *output_file, const parzip_options_t *opts) {
     FILE *input_fp = NULL, *output_fp = NULL;
+    int input_fd = -1, output_fd = -1;
+    int threads = opts->threads;
+    int block_size = opts->block_size;
+    int compression_level = opts->compression_level;
+    int direct_io = opts->direct_io;
+    unsigned char *table_buffer = NULL;
+    rate_controller_t rate_controller;
+    rate_controller_t *controller = NULL;
+    struct timespec start;
     struct stat file_stat;
     parzip_header_t header;
     block_info_t *block_infos = NULL;
+    block_digest_t *block_hashes = NULL;
+    parzip_shard_info_t shard_info;
+    parzip_header_t base_header;
+    block_info_t *base_infos = NULL;
+    block_digest_t *base_hashes = NULL;
+    int base_fd = -1;
     thread_data_t *thread_data = NULL;
     pthread_t *thread_ids = NULL;
     pthread_mutex_t output_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -109,6 +425,32 @@ int compress_file(const char *input_file, const char *output_file, int threads,
         return -1;
     }
     
+    // Re-archivado incremental: los bloques se comparan por posición, así que se usa
+    // el mismo tamaño de bloque que el archivo base
+    if (opts->base_file) {
+        struct stat base_stat, output_stat;
+        if (stat(opts->base_file, &base_stat) == 0 && stat(output_file, &output_stat) == 0 &&
+            base_stat.st_dev == output_stat.st_dev && base_stat.st_ino == output_stat.st_ino) {
+            fprintf(stderr, "Error: El archivo de salida no puede ser el archivo base\n");
+            return -1;
+        }
+        if (load_base_archive(opts->base_file, &base_header, &base_infos, &base_hashes) != 0) {
+            result = -1;
+            goto cleanup;
+        }
+        base_fd = open(opts->base_file, O_RDONLY | O_CLOEXEC);
+        if (base_fd < 0) {
+            fprintf(stderr, "Error: No se pudo abrir el archivo base: %s\n", opts->base_file);
+            result = -1;
+            goto cleanup;
+        }
+        printf("♻️ Archivo base: %s (%u bloques)\n", opts->base_file, base_header.num_blocks);
+        if (base_header.block_size != (uint32_t)block_size) {
+            printf("🧩 Usando el tamaño de bloque de la base: %u bytes\n", base_header.block_size);
+            block_size = base_header.block_size;
+        }
+    }
+    
     uint64_t file_size = file_stat.st_size;
     uint32_t num_blocks = (file_size + block_size - 1) / block_size;
     
@@ -116,64 +458,132 @@ int compress_file(const char *input_file, const char *output_file, int threads,
     printf("🧩 Bloques: %d (tamaño: %d bytes)\n", num_blocks, block_size);
     printf("🧵 Hilos: %d\n", threads);
     printf("⚙️ Nivel compresión: %d\n", compression_level);
+    if (opts->target_rate > 0) {
+        printf("🎯 Throughput objetivo: %.1f MB/s (nivel adaptativo por bloque)\n", opts->target_rate);
+    }
+    
+    if (direct_io && block_size % DIRECT_IO_ALIGN != 0) {
+        fprintf(stderr, "Error: Con --direct el tamaño de bloque debe ser múltiplo de %d\n", DIRECT_IO_ALIGN);
+        result = -1;
+        goto cleanup;
+    }
     
     // Preparar header
-    header.magic = MAGIC_NUMBER;
+    memset(&header, 0, sizeof(header));
+    header.magic = MAGIC_NUMBER_V2;
+    header.flags = PARZIP_FLAG_BLOCK_HASHES;
     header.num_blocks = num_blocks;
     header.block_size = block_size;
     header.compression_level = compression_level;
     header.original_size = file_size;
+    if (opts->shard_count > 0) {
+        header.flags |= PARZIP_FLAG_PARTIAL;
+    }
     
     // Abrir archivos
-    input_fp = fopen(input_file, "rb");
-    output_fp = fopen(output_file, "wb");
-    
-    if (!input_fp || !output_fp) {
-        fprintf(stderr, "Error: No se pudieron abrir los archivos\n");
-        result = -1;
-        goto cleanup;
+    if (direct_io) {
+        int rc = open_direct_pair(input_file, output_file, &input_fd, &output_fd);
+        if (rc < 0) {
+            result = -1;
+            goto cleanup;
+        }
+        if (rc > 0) direct_io = 0;
+        else printf("💽 E/S directa (O_DIRECT) activada\n");
     }
     
-    // Escribir header
-    if (write_parzip_header(output_fp, &header) != 0) {
-        fprintf(stderr, "Error: No se pudo escribir el header\n");
-        result = -1;
-        goto cleanup;
+    if (!direct_io) {
+        input_fp = fopen(input_file, "rb");
+        output_fp = fopen(output_file, "wb");
+        
+        if (!input_fp || !output_fp) {
+            fprintf(stderr, "Error: No se pudieron abrir los archivos\n");
+            result = -1;
+            goto cleanup;
+        }
+        
+        // Escribir header
+        if (write_parzip_header(output_fp, &header) != 0) {
+            fprintf(stderr, "Error: No se pudo escribir el header\n");
+            result = -1;
+            goto cleanup;
+        }
     }
     
     // Allocar memoria para información de bloques
     block_infos = calloc(num_blocks, sizeof(block_info_t));
+    block_hashes = calloc(num_blocks ? num_blocks : 1, sizeof(block_digest_t));
     thread_data = calloc(threads, sizeof(thread_data_t));
     thread_ids = calloc(threads, sizeof(pthread_t));
     
-    if (!block_infos || !thread_data || !thread_ids) {
+    if (!block_infos || !block_hashes || !thread_data || !thread_ids) {
         fprintf(stderr, "Error: No se pudo allocar memoria\n");
         result = -1;
         goto cleanup;
     }
     
+    // Detectar huecos del archivo de entrada para no leerlos
+    int scan_fd = open(input_file, O_RDONLY | O_CLOEXEC);
+    uint32_t hole_blocks = 0;
+    if (scan_fd >= 0) {
+        hole_blocks = mark_hole_blocks(scan_fd, &header, block_infos);
+        close(scan_fd);
+    }
+    if (hole_blocks > 0) {
+        printf("🕳️ Bloques en huecos del archivo: %u (no se leerán)\n", hole_blocks);
+    }
+    
+    // Fragmento (--shard): la tabla describe el archivo completo, pero solo se
+    // comprime el rango de bloques propio; el resto queda marcado como ausente
+    uint64_t input_bytes = file_size;
+    if (opts->shard_count > 0) {
+        uint32_t first = (uint64_t)(opts->shard_index - 1) * num_blocks / opts->shard_count;
+        uint32_t last = (uint64_t)opts->shard_index * num_blocks / opts->shard_count;
+        
+        input_bytes = 0;
+        for (uint32_t i = 0; i < num_blocks; i++) {
+            if (i < first || i >= last) {
+                block_infos[i].flags |= BLOCK_FLAG_ABSENT;
+            } else {
+                uint64_t end = (uint64_t)(i + 1) * block_size < file_size ? (uint64_t)(i + 1) * block_size : file_size;
+                input_bytes += end - (uint64_t)i * block_size;
+            }
+        }
+        printf("🧩 Fragmento %d/%d: bloques %u a %u (%lu bytes)\n", opts->shard_index, opts->shard_count,
+               first, last ? last - 1 : 0, (unsigned long)input_bytes);
+        
+        memset(&shard_info, 0, sizeof(shard_info));
+        shard_info.shard_index = opts->shard_index;
+        shard_info.shard_count = opts->shard_count;
+        if (shard_fingerprint(input_file, file_size, &shard_info.fingerprint) != 0) {
+            fprintf(stderr, "Error: No se pudo calcular la huella del archivo original\n");
+            result = -1;
+            goto cleanup;
+        }
+    }
+    
     // Calcular offsets para cada bloque en el archivo de salida
-    uint64_t current_offset = sizeof(parzip_header_t) + num_blocks * sizeof(block_info_t);
+    plan_parzip_blocks(&header, block_infos, direct_io ? DIRECT_IO_ALIGN : 1);
     
-    for (uint32_t i = 0; i < num_blocks; i++) {
-        block_infos[i].block_id = i;
-        block_infos[i].original_size = (i == num_blocks - 1) ? 
-            (file_size % block_size == 0 ? block_size : file_size % block_size) : block_size;
-        block_infos[i].offset = current_offset;
-        current_offset += compressBound(block_infos[i].original_size);
+    if (opts->target_rate > 0) {
+        rate_controller_init(&rate_controller, opts->target_rate, threads, compression_level);
+        controller = &rate_controller;
     }
     
     printf("\n🚀 Iniciando compresión paralela...\n");
+    clock_gettime(CLOCK_MONOTONIC, &start);
     
-    // Procesar bloques con hilos
-    uint32_t blocks_processed = 0;
+    // Procesar bloques con hilos (los bloques de ceros no necesitan hilo)
+    uint32_t next_block = 0;
     
-    while (blocks_processed < num_blocks && !error_flag) {
+    while (next_block < num_blocks && !error_flag) {
         int active_threads = 0;
         
         // Lanzar hilos para procesar bloques
-        for (int t = 0; t < threads && blocks_processed + t < num_blocks; t++) {
-            uint32_t block_id = blocks_processed + t;
+        for (; active_threads < threads && next_block < num_blocks; next_block++) {
+            uint32_t block_id = next_block;
+            int t = active_threads;
+            
+            if (block_infos[block_id].flags & (BLOCK_FLAG_ZERO | BLOCK_FLAG_ABSENT)) continue;
             
             thread_data[t].thread_id = t;
             thread_data[t].input_file = input_file;
@@ -187,6 +597,14 @@ int compress_file(const char *input_file, const char *output_file, int threads,
             thread_data[t].output_fp = output_fp;
             thread_data[t].block_info = &block_infos[block_id];
             thread_data[t].error_flag = &error_flag;
+            thread_data[t].direct_io = direct_io;
+            thread_data[t].input_fd = input_fd;
+            thread_data[t].output_fd = output_fd;
+            thread_data[t].rate_controller = controller;
+            thread_data[t].block_hash = &block_hashes[block_id];
+            thread_data[t].base_info = (base_infos && block_id < base_header.num_blocks) ? &base_infos[block_id] : NULL;
+            thread_data[t].base_hash = thread_data[t].base_info ? &base_hashes[block_id] : NULL;
+            thread_data[t].base_fd = base_fd;
             
             if (pthread_create(&thread_ids[t], NULL, compress_block_thread, &thread_data[t]) != 0) {
                 fprintf(stderr, "Error: No se pudo crear el hilo %d\n", t);
@@ -200,8 +618,6 @@ int compress_file(const char *input_file, const char *output_file, int threads,
         for (int t = 0; t < active_threads; t++) {
             pthread_join(thread_ids[t], NULL);
         }
-        
-        blocks_processed += active_threads;
     }
     
     if (error_flag) {
@@ -210,11 +626,58 @@ int compress_file(const char *input_file, const char *output_file, int threads,
         goto cleanup;
     }
     
-    // Escribir información de bloques al archivo
-    fseek(output_fp, sizeof(parzip_header_t), SEEK_SET);
-    for (uint32_t i = 0; i < num_blocks; i++) {
-        if (write_parzip_block_info(output_fp, &block_infos[i]) != 0) {
-            fprintf(stderr, "Error: No se pudo escribir información del bloque %d\n", i);
+    if (direct_io) {
+        // Header y tablas en una única escritura alineada al inicio del archivo
+        size_t table_size = parzip_data_offset(&header);
+        size_t padded_size = ALIGN_UP(table_size, DIRECT_IO_ALIGN);
+        uint64_t end_offset = num_blocks ? block_infos[num_blocks - 1].offset + block_infos[num_blocks - 1].compressed_size : table_size;
+        
+        table_buffer = alloc_aligned(padded_size);
+        if (!table_buffer) {
+            fprintf(stderr, "Error: No se pudo allocar memoria\n");
+            result = -1;
+            goto cleanup;
+        }
+        memset(table_buffer, 0, padded_size);
+        memcpy(table_buffer, &header, sizeof(parzip_header_t));
+        memcpy(table_buffer + sizeof(parzip_header_t), block_infos, (size_t)num_blocks * sizeof(block_info_t));
+        memcpy(table_buffer + sizeof(parzip_header_t) + (size_t)num_blocks * sizeof(block_info_t),
+               block_hashes, (size_t)num_blocks * sizeof(block_digest_t));
+        if (opts->shard_count > 0) {
+            memcpy(table_buffer + table_size - sizeof(parzip_shard_info_t), &shard_info, sizeof(parzip_shard_info_t));
+        }
+        
+        if (pwrite_full(output_fd, table_buffer, padded_size, 0) != 0) {
+            fprintf(stderr, "Error: No se pudo escribir el header\n");
+            result = -1;
+            goto cleanup;
+        }
+        
+        // Recortar el relleno de alineación tras el último bloque
+        if (ftruncate(output_fd, end_offset) != 0) {
+            fprintf(stderr, "Advertencia: No se pudo truncar el archivo al tamaño exacto\n");
+        }
+    } else {
+        // Escribir información de bloques al archivo
+        fseek(output_fp, sizeof(parzip_header_t), SEEK_SET);
+        for (uint32_t i = 0; i < num_blocks; i++) {
+            if (write_parzip_block_info(output_fp, &block_infos[i]) != 0) {
+                fprintf(stderr, "Error: No se pudo escribir información del bloque %d\n", i);
+                result = -1;
+                goto cleanup;
+            }
+        }
+        
+        // Escribir tabla de hashes a continuación
+        if (fwrite(block_hashes, sizeof(block_digest_t), num_blocks, output_fp) != num_blocks) {
+            fprintf(stderr, "Error: No se pudo escribir la tabla de hashes\n");
+            result = -1;
+            goto cleanup;
+        }
+        
+        // Registro del fragmento, justo antes de los datos
+        if (opts->shard_count > 0 && fwrite(&shard_info, sizeof(parzip_shard_info_t), 1, output_fp) != 1) {
+            fprintf(stderr, "Error: No se pudo escribir el registro del fragmento\n");
             result = -1;
             goto cleanup;
         }
@@ -222,18 +685,56 @@ int compress_file(const char *input_file, const char *output_file, int threads,
     
     // Calcular estadísticas
     uint64_t total_compressed = 0;
+    uint32_t zero_blocks = 0;
+    uint32_t reused_blocks = 0;
+    uint32_t absent_blocks = 0;
     for (uint32_t i = 0; i < num_blocks; i++) {
         total_compressed += block_infos[i].compressed_size;
+        if (block_infos[i].flags & BLOCK_FLAG_ABSENT) absent_blocks++;
+        else if (block_infos[i].flags & BLOCK_FLAG_ZERO) zero_blocks++;
+        else if (base_infos && i < base_header.num_blocks &&
+                 memcmp(&base_hashes[i], &block_hashes[i], sizeof(block_digest_t)) == 0 &&
+                 base_infos[i].original_size == block_infos[i].original_size &&
+                 !(base_infos[i].flags & BLOCK_FLAG_ZERO)) reused_blocks++;
     }
     
     printf("\n✅ Compresión completada exitosamente!\n");
-    printf("📊 Tamaño original: %ld bytes\n", file_size);
+    printf("📊 Tamaño original: %ld bytes\n", input_bytes);
     printf("📦 Tamaño comprimido: %ld bytes\n", total_compressed);
-    printf("💾 Reducción: %.2f%%\n", 100.0 * (1.0 - (double)total_compressed / file_size));
+    if (zero_blocks > 0) {
+        printf("⚪ Bloques de ceros: %u de %u\n", zero_blocks, num_blocks);
+    }
+    if (base_infos) {
+        printf("♻️ Bloques reutilizados de la base: %u de %u (recomprimidos: %u)\n",
+               reused_blocks, num_blocks - absent_blocks, num_blocks - absent_blocks - reused_blocks - zero_blocks);
+    }
+    if (controller) {
+        uint32_t level_blocks[10] = {0};
+        double seconds = elapsed_seconds(&start);
+        for (uint32_t i = 0; i < num_blocks; i++) {
+            if (!(block_infos[i].flags & (BLOCK_FLAG_ZERO | BLOCK_FLAG_ABSENT)) && block_infos[i].level <= 9) level_blocks[block_infos[i].level]++;
+        }
+        printf("⏱️ Throughput: %.1f MB/s (objetivo: %.1f MB/s)\n",
+               seconds > 0 ? input_bytes / seconds / 1e6 : 0.0, opts->target_rate);
+        printf("📈 Bloques por nivel:");
+        for (int l = 0; l <= 9; l++) {
+            if (level_blocks[l]) printf(" %d:%u", l, level_blocks[l]);
+        }
+        printf("\n");
+    }
+    printf("💾 Reducción: %.2f%%\n", input_bytes ? 100.0 * (1.0 - (double)total_compressed / input_bytes) : 0.0);
     
 cleanup:
     if (input_fp) fclose(input_fp);
     if (output_fp) fclose(output_fp);
+    if (input_fd >= 0) close(input_fd);
+    if (output_fd >= 0) close(output_fd);
+    if (table_buffer) free(table_buffer);
+    if (block_hashes) free(block_hashes);
+    if (base_infos) free(base_infos);
+    if (base_hashes) free(base_hashes);
+    if (base_fd >= 0) close(base_fd);
+    if (controller) pthread_mutex_destroy(&controller->mutex);
     if (block_infos) free(block_infos);
     if (thread_data) free(thread_data);
     if (thread_ids) free(thread_ids);
@@ -248,56 +749,108 @@ void* decompress_block_thread(void* arg) {
     FILE *input_fp = NULL;
     unsigned char *input_buffer = NULL;
     unsigned char *output_buffer = NULL;
+    unsigned char *compressed_data = NULL;
     uLongf decompressed_size;
     int result = Z_OK;
     
-    // Abrir archivo de entrada
-    input_fp = fopen(data->input_file, "rb");
-    if (!input_fp) {
-        fprintf(stderr, "Error: No se pudo abrir el archivo comprimido en hilo %d\n", data->thread_id);
-        *data->error_flag = 1;
-        return NULL;
+    if (data->direct_io) {
+        // Modo directo: leer la ventana alineada que contiene el bloque comprimido
+        uint64_t aligned_start = (data->block_info->offset / DIRECT_IO_ALIGN) * DIRECT_IO_ALIGN;
+        size_t head = data->block_info->offset - aligned_start;
+        size_t span = ALIGN_UP(head + data->block_info->compressed_size, DIRECT_IO_ALIGN);
+        
+        input_buffer = alloc_aligned(span);
+        output_buffer = alloc_aligned(ALIGN_UP(data->block_info->original_size, DIRECT_IO_ALIGN));
+        
+        if (!input_buffer || !output_buffer) {
+            fprintf(stderr, "Error: No se pudo allocar memoria en hilo %d\n", data->thread_id);
+            *data->error_flag = 1;
+            goto cleanup;
+        }
+        
+        ssize_t bytes_read = pread_direct(data->input_fd, input_buffer, span, aligned_start);
+        if (bytes_read < (ssize_t)(head + data->block_info->compressed_size)) {
+            fprintf(stderr, "Error: No se pudo leer el bloque comprimido %d en hilo %d\n", data->block_id, data->thread_id);
+            *data->error_flag = 1;
+            goto cleanup;
+        }
+        compressed_data = input_buffer + head;
+    } else {
+        // Abrir archivo de entrada
+        input_fp = fopen(data->input_file, "rb");
+        if (!input_fp) {
+            fprintf(stderr, "Error: No se pudo abrir el archivo comprimido en hilo %d\n", data->thread_id);
+            *data->error_flag = 1;
+            return NULL;
+        }
+        
+        // Allocar buffers
+        input_buffer = malloc(data->block_info->compressed_size);
+        output_buffer = malloc(data->block_info->original_size);
+        
+        if (!input_buffer || !output_buffer) {
+            fprintf(stderr, "Error: No se pudo allocar memoria en hilo %d\n", data->thread_id);
+            *data->error_flag = 1;
+            goto cleanup;
+        }
+        
+        // Leer bloque comprimido desde el archivo
+        fseek(input_fp, data->block_info->offset, SEEK_SET);
+        size_t bytes_read = fread(input_buffer, 1, data->block_info->compressed_size, input_fp);
+        if (bytes_read != data->block_info->compressed_size) {
+            fprintf(stderr, "Error: No se pudo leer el bloque comprimido %d en hilo %d\n", data->block_id, data->thread_id);
+            *data->error_flag = 1;
+            goto cleanup;
+        }
+        compressed_data = input_buffer;
     }
     
-    // Allocar buffers
-    input_buffer = malloc(data->block_info->compressed_size);
-    output_buffer = malloc(data->block_info->original_size);
+    // Descomprimir el bloque
+    decompressed_size = data->block_info->original_size;
+    result = uncompress(output_buffer, &decompressed_size, compressed_data, data->block_info->compressed_size);
     
-    if (!input_buffer || !output_buffer) {
-        fprintf(stderr, "Error: No se pudo allocar memoria en hilo %d\n", data->thread_id);
+    if (result != Z_OK || decompressed_size != data->block_info->original_size) {
+        fprintf(stderr, "Error: Fallo en descompresión del bloque %d en hilo %d (código: %d)\n", data->block_id, data->thread_id, result);
         *data->error_flag = 1;
         goto cleanup;
     }
     
-    // Leer bloque comprimido desde el archivo
-    fseek(input_fp, data->block_info->offset, SEEK_SET);
-    size_t bytes_read = fread(input_buffer, 1, data->block_info->compressed_size, input_fp);
-    if (bytes_read != data->block_info->compressed_size) {
-        fprintf(stderr, "Error: No se pudo leer el bloque comprimido %d en hilo %d\n", data->block_id, data->thread_id);
+    // Verificar integridad del bloque contra la tabla de digests (formato V2)
+    if (data->block_hash && !block_digest_matches(output_buffer, decompressed_size, data->block_hash)) {
+        fprintf(stderr, "Error: El bloque %d no coincide con su hash (archivo corrupto)\n", data->block_id);
         *data->error_flag = 1;
         goto cleanup;
     }
     
-    // Descomprimir el bloque
-    decompressed_size = data->block_info->original_size;
-    result = uncompress(output_buffer, &decompressed_size, input_buffer, data->block_info->compressed_size);
-    
-    if (result != Z_OK || decompressed_size != data->block_info->original_size) {
-        fprintf(stderr, "Error: Fallo en descompresión del bloque %d en hilo %d (código: %d)\n", data->block_id, data->thread_id, result);
-        *data->error_flag = 1;
+    // Un bloque que resulta ser todo ceros no se escribe: la salida ya tiene un hueco ahí
+    if (is_zero_block(output_buffer, decompressed_size)) {
+        printf("⚪ Bloque %d descomprimido: %d bytes de ceros (hueco)\n", data->block_id, (int)decompressed_size);
         goto cleanup;
     }
     
+    // Calcular posición en el archivo de salida
+    uint64_t output_offset = (uint64_t)data->block_id * data->block_size;
+    
+    // En modo directo el último bloque se rellena hasta la alineación; el ftruncate final lo recorta
+    int write_failed = 0;
+    if (data->direct_io) {
+        size_t padded_size = ALIGN_UP(decompressed_size, DIRECT_IO_ALIGN);
+        memset(output_buffer + decompressed_size, 0, padded_size - decompressed_size);
+        write_failed = pwrite_full(data->output_fd, output_buffer, padded_size, output_offset) != 0;
+    }
+    
     // Escribir bloque descomprimido al archivo de salida (con mutex)
     pthread_mutex_lock(data->output_mutex);
     
-    // Calcular posición en el archivo de salida
-    uint64_t output_offset = (uint64_t)data->block_id * data->block_size;
-    fseek(data->output_fp, output_offset, SEEK_SET);
+    if (!data->direct_io) {
+        fseek(data->output_fp, output_offset, SEEK_SET);
+        
+        // Escribir datos descomprimidos
+        size_t written = fwrite(output_buffer, 1, decompressed_size, data->output_fp);
+        write_failed = written != decompressed_size;
+    }
     
-    // Escribir datos descomprimidos
-    size_t written = fwrite(output_buffer, 1, decompressed_size, data->output_fp);
-    if (written != decompressed_size) {
+    if (write_failed) {
         fprintf(stderr, "Error: No se pudo escribir el bloque descomprimido %d\n", data->block_id);
         *data->error_flag = 1;
     } else {
@@ -316,9 +869,20 @@ cleanup:
 
 // Función de descompresión
 int decompress_file(const char *input_file, const char *output_file, int threads) {
+    parzip_options_t opts;
+    parzip_default_options(&opts);
+    opts.threads = threads;
+    return decompress_file_ex(input_file, output_file, &opts);
+}
+
+int decompress_file_ex(const char *input_file, const char *output_file, const parzip_options_t *opts) {
     FILE *input_fp = NULL, *output_fp = NULL;
+    int input_fd = -1, output_fd = -1;
+    int threads = opts->threads;
+    int direct_io = opts->direct_io;
     parzip_header_t header;
     block_info_t *block_infos = NULL;
+    block_digest_t *block_hashes = NULL;
     thread_data_t *thread_data = NULL;
     pthread_t *thread_ids = NULL;
     pthread_mutex_t output_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -344,64 +908,103 @@ int decompress_file(const char *input_file, const char *output_file, int threads
     }
     
     // Verificar número mágico
-    if (header.magic != MAGIC_NUMBER) {
+    if (!is_parzip_magic(header.magic)) {
         fprintf(stderr, "Error: El archivo no es un archivo .pz válido (magic: 0x%lx)\n", header.magic);
         result = -1;
         goto cleanup;
     }
+    if (parzip_flags(&header) & PARZIP_FLAG_PARTIAL) {
+        fprintf(stderr, "Error: El archivo es un fragmento (--shard); únalo primero con --merge\n");
+        result = -1;
+        goto cleanup;
+    }
+    // Cada stream zlib ya trae su Adler-32; el SHA-256 por bloque solo se comprueba con --verify
+    int verify = opts->verify && (parzip_flags(&header) & PARZIP_FLAG_BLOCK_HASHES);
+    if (opts->verify && !verify) {
+        printf("⚠️  El archivo no tiene digests (formato anterior): --verify no puede comprobar los bloques\n");
+    }
     
     printf("📊 Archivo original: %ld bytes\n", header.original_size);
     printf("🧩 Bloques: %d (tamaño: %d bytes)\n", header.num_blocks, header.block_size);
     printf("⚙️ Nivel compresión original: %d\n", header.compression_level);
     printf("🧵 Hilos: %d\n", threads);
+    if (verify) {
+        printf("🔏 Verificando cada bloque contra su SHA-256\n");
+    }
     
     // Allocar memoria para información de bloques
     block_infos = calloc(header.num_blocks, sizeof(block_info_t));
+    block_hashes = calloc(header.num_blocks ? header.num_blocks : 1, sizeof(block_digest_t));
     thread_data = calloc(threads, sizeof(thread_data_t));
     thread_ids = calloc(threads, sizeof(pthread_t));
     
-    if (!block_infos || !thread_data || !thread_ids) {
+    if (!block_infos || !block_hashes || !thread_data || !thread_ids) {
         fprintf(stderr, "Error: No se pudo allocar memoria\n");
         result = -1;
         goto cleanup;
     }
     
-    // Leer información de bloques
-    for (uint32_t i = 0; i < header.num_blocks; i++) {
-        if (read_parzip_block_info(input_fp, &block_infos[i]) != 0) {
-            fprintf(stderr, "Error: No se pudo leer información del bloque %d\n", i);
+    // Leer información de bloques (y hashes, si el archivo los tiene)
+    if (read_parzip_tables(input_fp, &header, block_infos, block_hashes) != 0) {
+        fprintf(stderr, "Error: No se pudo leer la tabla de bloques\n");
+        result = -1;
+        goto cleanup;
+    }
+    
+    // El modo directo necesita offsets de salida alineados (bloques múltiplos de DIRECT_IO_ALIGN)
+    if (direct_io && header.block_size % DIRECT_IO_ALIGN != 0) {
+        printf("⚠️  Bloques de %d bytes no alineados para O_DIRECT, usando E/S con buffer\n", header.block_size);
+        direct_io = 0;
+    }
+    if (direct_io) {
+        int rc = open_direct_pair(input_file, output_file, &input_fd, &output_fd);
+        if (rc < 0) {
             result = -1;
             goto cleanup;
         }
+        if (rc > 0) direct_io = 0;
+        else printf("💽 E/S directa (O_DIRECT) activada\n");
     }
     
-    // Crear archivo de salida
-    output_fp = fopen(output_file, "wb");
-    if (!output_fp) {
-        fprintf(stderr, "Error: No se pudo crear el archivo de salida: %s\n", output_file);
-        result = -1;
-        goto cleanup;
-    }
-    
-    // Pre-allocar el archivo de salida al tamaño completo
-    if (fseek(output_fp, header.original_size - 1, SEEK_SET) != 0 || fputc(0, output_fp) == EOF) {
-        fprintf(stderr, "Error: No se pudo pre-allocar el archivo de salida\n");
-        result = -1;
-        goto cleanup;
+    if (direct_io) {
+        // Pre-allocar el archivo de salida al tamaño completo
+        if (ftruncate(output_fd, header.original_size) != 0) {
+            fprintf(stderr, "Error: No se pudo pre-allocar el archivo de salida\n");
+            result = -1;
+            goto cleanup;
+        }
+    } else {
+        // Crear archivo de salida
+        output_fp = fopen(output_file, "wb");
+        if (!output_fp) {
+            fprintf(stderr, "Error: No se pudo crear el archivo de salida: %s\n", output_file);
+            result = -1;
+            goto cleanup;
+        }
+        
+        // Extender el archivo de salida al tamaño completo sin escribir datos
+        // (las zonas de bloques de ceros quedan como huecos)
+        if (ftruncate(fileno(output_fp), header.original_size) != 0) {
+            fprintf(stderr, "Error: No se pudo pre-allocar el archivo de salida\n");
+            result = -1;
+            goto cleanup;
+        }
     }
-    rewind(output_fp);
     
     printf("\n🚀 Iniciando descompresión paralela...\n");
     
-    // Procesar bloques con hilos
-    uint32_t blocks_processed = 0;
+    // Procesar bloques con hilos (los bloques de ceros no necesitan hilo)
+    uint32_t next_block = 0;
     
-    while (blocks_processed < header.num_blocks && !error_flag) {
+    while (next_block < header.num_blocks && !error_flag) {
         int active_threads = 0;
         
         // Lanzar hilos para procesar bloques
-        for (int t = 0; t < threads && blocks_processed + t < header.num_blocks; t++) {
-            uint32_t block_id = blocks_processed + t;
+        for (; active_threads < threads && next_block < header.num_blocks; next_block++) {
+            uint32_t block_id = next_block;
+            int t = active_threads;
+            
+            if (block_infos[block_id].flags & BLOCK_FLAG_ZERO) continue;
             
             thread_data[t].thread_id = t;
             thread_data[t].input_file = input_file;
@@ -413,6 +1016,10 @@ int decompress_file(const char *input_file, const char *output_file, int threads
             thread_data[t].output_fp = output_fp;
             thread_data[t].block_info = &block_infos[block_id];
             thread_data[t].error_flag = &error_flag;
+            thread_data[t].direct_io = direct_io;
+            thread_data[t].input_fd = input_fd;
+            thread_data[t].output_fd = output_fd;
+            thread_data[t].block_hash = verify ? &block_hashes[block_id] : NULL;
             
             if (pthread_create(&thread_ids[t], NULL, decompress_block_thread, &thread_data[t]) != 0) {
                 fprintf(stderr, "Error: No se pudo crear el hilo %d\n", t);
@@ -426,8 +1033,6 @@ int decompress_file(const char *input_file, const char *output_file, int threads
         for (int t = 0; t < active_threads; t++) {
             pthread_join(thread_ids[t], NULL);
         }
-        
-        blocks_processed += active_threads;
     }
     
     if (error_flag) {
@@ -436,8 +1041,9 @@ int decompress_file(const char *input_file, const char *output_file, int threads
         goto cleanup;
     }
     
-    // Truncar el archivo al tamaño exacto (en caso de que el último bloque sea menor)
-    if (ftruncate(fileno(output_fp), header.original_size) != 0) {
+    // Truncar el archivo al tamaño exacto (en caso de que el último bloque sea menor
+    // o, en modo directo, de que se haya escrito relleno de alineación)
+    if (ftruncate(direct_io ? output_fd : fileno(output_fp), header.original_size) != 0) {
         fprintf(stderr, "Advertencia: No se pudo truncar el archivo al tamaño exacto\n");
     }
     
@@ -448,10 +1054,236 @@ int decompress_file(const char *input_file, const char *output_file, int threads
 cleanup:
     if (input_fp) fclose(input_fp);
     if (output_fp) fclose(output_fp);
+    if (input_fd >= 0) close(input_fd);
+    if (output_fd >= 0) close(output_fd);
     if (block_infos) free(block_infos);
+    if (block_hashes) free(block_hashes);
     if (thread_data) free(thread_data);
     if (thread_ids) free(thread_ids);
     pthread_mutex_destroy(&output_mutex);
     
     return result;
 }
+
+// Unir los fragmentos de --shard en un único .pz: se reescriben header, tablas y
+// offsets, y los datos comprimidos se copian tal cual (sin recomprimir)
+int merge_parzip_files(const char *output_file, char *const *input_files, int num_inputs) {
+    parzip_header_t header;
+    parzip_header_t part_header;
+    parzip_shard_info_t shard_info;
+    parzip_shard_info_t part_info;
+    block_info_t *block_infos = NULL;
+    block_info_t *part_infos = NULL;
+    block_digest_t *block_hashes = NULL;
+    block_digest_t *part_hashes = NULL;
+    int *owners = NULL;             // Fragmento que aporta cada bloque
+    int *shard_inputs = NULL;       // Entrada que aporta cada fragmento (por índice)
+    int *input_fds = NULL;
+    int output_fd = -1;
+    int result = 0;
+    struct timespec start;
+    
+    printf("🔗 Uniendo %d fragmentos...\n", num_inputs);
+    printf("📁 Archivo salida: %s\n", output_file);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    
+    input_fds = malloc(num_inputs * sizeof(int));
+    if (!input_fds) {
+        fprintf(stderr, "Error: No se pudo allocar memoria\n");
+        return -1;
+    }
+    for (int p = 0; p < num_inputs; p++) input_fds[p] = -1;
+    memset(&shard_info, 0, sizeof(shard_info));
+    
+    for (int p = 0; p < num_inputs; p++) {
+        FILE *fp = fopen(input_files[p], "rb");
+        if (!fp) {
+            fprintf(stderr, "Error: No se pudo abrir el fragmento: %s\n", input_files[p]);
+            result = -1;
+            goto cleanup;
+        }
+        
+        // Todos los fragmentos deben describir el mismo archivo original
+        if (read_parzip_header(fp, &part_header) != 0 || !is_parzip_magic(part_header.magic) ||
+            !(parzip_flags(&part_header) & PARZIP_FLAG_PARTIAL)) {
+            fprintf(stderr, "Error: '%s' no es un fragmento .pz (créelo con -c --shard i/N)\n", input_files[p]);
+            fclose(fp);
+            result = -1;
+            goto cleanup;
+        }
+        if (read_parzip_shard_info(fp, &part_header, &part_info) != 0) {
+            fprintf(stderr, "Error: No se pudo leer el registro del fragmento '%s'\n", input_files[p]);
+            fclose(fp);
+            result = -1;
+            goto cleanup;
+        }
+        if (p == 0) {
+            header = part_header;
+            shard_info = part_info;
+            shard_inputs = malloc(shard_info.shard_count * sizeof(int));
+            if (!shard_inputs) {
+                fprintf(stderr, "Error: No se pudo allocar memoria\n");
+                fclose(fp);
+                result = -1;
+                goto cleanup;
+            }
+            for (uint32_t s = 0; s < shard_info.shard_count; s++) shard_inputs[s] = -1;
+            block_infos = calloc(header.num_blocks ? header.num_blocks : 1, sizeof(block_info_t));
+            part_infos = calloc(header.num_blocks ? header.num_blocks : 1, sizeof(block_info_t));
+            block_hashes = calloc(header.num_blocks ? header.num_blocks : 1, sizeof(block_digest_t));
+            part_hashes = calloc(header.num_blocks ? header.num_blocks : 1, sizeof(block_digest_t));
+            owners = malloc((header.num_blocks ? header.num_blocks : 1) * sizeof(int));
+            if (!block_infos || !part_infos || !block_hashes || !part_hashes || !owners) {
+                fprintf(stderr, "Error: No se pudo allocar memoria\n");
+                fclose(fp);
+                result = -1;
+                goto cleanup;
+            }
+            for (uint32_t i = 0; i < header.num_blocks; i++) owners[i] = -1;
+        } else if (part_header.num_blocks != header.num_blocks || part_header.block_size != header.block_size ||
+                   part_header.original_size != header.original_size || part_header.flags != header.flags) {
+            fprintf(stderr, "Error: El fragmento '%s' no corresponde al mismo archivo que '%s'\n",
+                    input_files[p], input_files[0]);
+            fclose(fp);
+            result = -1;
+            goto cleanup;
+        }
+        
+        // La huella del original y el número de fragmentos deben coincidir en todos
+        if (memcmp(&part_info.fingerprint, &shard_info.fingerprint, sizeof(block_digest_t)) != 0 ||
+            part_info.shard_count != shard_info.shard_count) {
+            fprintf(stderr, "Error: El fragmento '%s' se creó a partir de un archivo distinto que '%s'\n",
+                    input_files[p], input_files[0]);
+            fclose(fp);
+            result = -1;
+            goto cleanup;
+        }
+        if (shard_inputs[part_info.shard_index - 1] >= 0) {
+            fprintf(stderr, "Error: El fragmento %u/%u está repetido ('%s' y '%s')\n", part_info.shard_index,
+                    part_info.shard_count, input_files[shard_inputs[part_info.shard_index - 1]], input_files[p]);
+            fclose(fp);
+            result = -1;
+            goto cleanup;
+        }
+        shard_inputs[part_info.shard_index - 1] = p;
+        
+        int rc = read_parzip_tables(fp, &part_header, part_infos, part_hashes);
+        fclose(fp);
+        if (rc != 0) {
+            fprintf(stderr, "Error: No se pudo leer la tabla de bloques de '%s'\n", input_files[p]);
+            result = -1;
+            goto cleanup;
+        }
+        
+        // Tomar los bloques presentes en este fragmento
+        uint32_t present = 0;
+        for (uint32_t i = 0; i < header.num_blocks; i++) {
+            if (part_infos[i].flags & BLOCK_FLAG_ABSENT) continue;
+            if (owners[i] >= 0) {
+                fprintf(stderr, "Error: El bloque %u está en '%s' y en '%s'\n", i, input_files[owners[i]], input_files[p]);
+                result = -1;
+                goto cleanup;
+            }
+            owners[i] = p;
+            block_infos[i] = part_infos[i];
+            block_hashes[i] = part_hashes[i];
+            present++;
+        }
+        printf("🧩 %s: fragmento %u/%u, %u bloques\n", input_files[p], part_info.shard_index, part_info.shard_count, present);
+        
+        input_fds[p] = open(input_files[p], O_RDONLY | O_CLOEXEC);
+        if (input_fds[p] < 0) {
+            fprintf(stderr, "Error: No se pudo abrir el fragmento: %s\n", input_files[p]);
+            result = -1;
+            goto cleanup;
+        }
+    }
+    
+    for (uint32_t s = 0; s < shard_info.shard_count; s++) {
+        if (shard_inputs[s] < 0) {
+            fprintf(stderr, "Error: Falta el fragmento %u/%u\n", s + 1, shard_info.shard_count);
+            result = -1;
+            goto cleanup;
+        }
+    }
+    for (uint32_t i = 0; i < header.num_blocks; i++) {
+        if (owners[i] < 0) {
+            fprintf(stderr, "Error: Ningún fragmento contiene el bloque %u (¿falta algún fragmento?)\n", i);
+            result = -1;
+            goto cleanup;
+        }
+    }
+    
+    // Header del archivo completo y offsets compactos (sin las reservas de cada fragmento)
+    header.flags &= ~PARZIP_FLAG_PARTIAL;
+    uint64_t current_offset = parzip_data_offset(&header);
+    for (uint32_t i = 0; i < header.num_blocks; i++) {
+        part_infos[i] = block_infos[i];   // Conservar el offset en el fragmento de origen
+        block_infos[i].offset = current_offset;
+        current_offset += block_infos[i].compressed_size;
+    }
+    
+    // La salida no puede pisar uno de los fragmentos que se están copiando
+    struct stat output_stat, part_stat;
+    if (stat(output_file, &output_stat) == 0) {
+        for (int p = 0; p < num_inputs; p++) {
+            if (fstat(input_fds[p], &part_stat) == 0 &&
+                part_stat.st_dev == output_stat.st_dev && part_stat.st_ino == output_stat.st_ino) {
+                fprintf(stderr, "Error: El archivo de salida no puede ser uno de los fragmentos\n");
+                result = -1;
+                goto cleanup;
+            }
+        }
+    }
+    
+    output_fd = open(output_file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (output_fd < 0) {
+        fprintf(stderr, "Error: No se pudo crear el archivo de salida: %s\n", output_file);
+        result = -1;
+        goto cleanup;
+    }
+    
+    size_t table_size = (size_t)header.num_blocks * sizeof(block_info_t);
+    if (pwrite_full(output_fd, &header, sizeof(parzip_header_t), 0) != 0 ||
+        pwrite_full(output_fd, block_infos, table_size, sizeof(parzip_header_t)) != 0 ||
+        pwrite_full(output_fd, block_hashes, (size_t)header.num_blocks * sizeof(block_digest_t),
+                    sizeof(parzip_header_t) + table_size) != 0) {
+        fprintf(stderr, "Error: No se pudo escribir el header\n");
+        result = -1;
+        goto cleanup;
+    }
+    
+    // Copiar los datos comprimidos de cada bloque desde su fragmento
+    for (uint32_t i = 0; i < header.num_blocks; i++) {
+        if (block_infos[i].compressed_size == 0) continue;
+        if (copy_file_region(input_fds[owners[i]], part_infos[i].offset, output_fd,
+                             block_infos[i].offset, block_infos[i].compressed_size) != 0) {
+            fprintf(stderr, "Error: No se pudo copiar el bloque %u\n", i);
+            result = -1;
+            goto cleanup;
+        }
+    }
+    
+    printf("\n✅ Fragmentos unidos exitosamente!\n");
+    printf("🧩 Bloques: %u (tamaño: %u bytes)\n", header.num_blocks, header.block_size);
+    printf("📊 Tamaño original: %lu bytes\n", (unsigned long)header.original_size);
+    printf("📦 Tamaño final: %lu bytes\n", (unsigned long)current_offset);
+    printf("⏱️ Tiempo: %.2f segundos\n", elapsed_seconds(&start));
+    
+cleanup:
+    if (input_fds) {
+        for (int p = 0; p < num_inputs; p++) {
+            if (input_fds[p] >= 0) close(input_fds[p]);
+        }
+        free(input_fds);
+    }
+    if (output_fd >= 0) close(output_fd);
+    if (block_infos) free(block_infos);
+    if (part_infos) free(part_infos);
+    if (block_hashes) free(block_hashes);
+    if (part_hashes) free(part_hashes);
+    if (owners) free(owners);
+    if (shard_inputs) free(shard_inputs);
+    
+    return result;
+}
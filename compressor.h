@@ -11,6 +11,20 @@
 #define DEFAULT_THREADS 4
 #define MAX_THREADS 32
 #define MAGIC_NUMBER 0x504152574F52ULL // "PARZIP" in hex
+#define MAGIC_NUMBER_V2 (MAGIC_NUMBER | 0x0200000000000000ULL) // Versión 2: header con flags válidos
+#define DIRECT_IO_ALIGN 4096      // Alineación de offsets, tamaños y buffers con O_DIRECT
+
+#define BLOCK_FLAG_ZERO 0x1       // Bloque de ceros: sin datos comprimidos en el archivo
+#define BLOCK_FLAG_ABSENT 0x2     // Bloque de otro fragmento (--shard): sin datos en este archivo
+
+#define PARZIP_FLAG_BLOCK_HASHES 0x1 // Tabla de digests (block_digest_t por bloque) tras la tabla de bloques
+#define PARZIP_FLAG_PARTIAL 0x2      // Fragmento de un archivo (--shard): lleva parzip_shard_info_t tras los digests
+
+#define BLOCK_DIGEST_SIZE 32      // SHA-256 del contenido original de un bloque
+#define SHARD_FINGERPRINT_SAMPLES 16   // Trozos del original que resume la huella de un fragmento
+#define SHARD_FINGERPRINT_CHUNK 65536  // Tamaño de cada trozo muestreado
+
+#define ALIGN_UP(x, a) ((((x) + (a) - 1) / (a)) * (a))
 
 // Estructura para el header del archivo comprimido
 typedef struct {
@@ -18,6 +32,7 @@ typedef struct {
     uint32_t num_blocks;      // Número total de bloques
     uint32_t block_size;      // Tamaño de cada bloque
     uint32_t compression_level; // Nivel de compresión usado
+    uint32_t flags;           // PARZIP_FLAG_* (solo válido con MAGIC_NUMBER_V2)
     uint64_t original_size;   // Tamaño original del archivo
 } parzip_header_t;
 
@@ -26,9 +41,34 @@ typedef struct {
     uint32_t block_id;        // ID del bloque
     uint32_t original_size;   // Tamaño original del bloque
     uint32_t compressed_size; // Tamaño comprimido del bloque
+    uint16_t flags;           // BLOCK_FLAG_* (ocupa el antiguo relleno de alineación)
+    uint16_t level;           // Nivel zlib usado en este bloque
     uint64_t offset;          // Offset en el archivo comprimido
 } block_info_t;
 
+// Digest del contenido original de un bloque (identifica bloques sin cambios con --base)
+typedef struct {
+    unsigned char bytes[BLOCK_DIGEST_SIZE];
+} block_digest_t;
+
+// Registro de un fragmento (--shard), a continuación de la tabla de digests
+typedef struct {
+    uint32_t shard_index;     // Fragmento (1..shard_count)
+    uint32_t shard_count;     // Número de fragmentos en que se dividió el archivo
+    block_digest_t fingerprint; // Huella del archivo original; --merge exige que coincida
+} parzip_shard_info_t;
+
+// Controlador del nivel de compresión adaptativo (--target-rate)
+typedef struct {
+    pthread_mutex_t mutex;
+    double target_rate;       // Throughput objetivo en MB/s (todos los hilos)
+    int threads;              // Hilos que comprimen en paralelo
+    int level;                // Nivel que usarán los próximos bloques
+    int blocks_since_change;  // Bloques medidos desde el último cambio de nivel
+    double recent_bytes;      // Bytes recientes (media móvil exponencial)
+    double recent_seconds;    // Tiempo reciente por hilo (media móvil exponencial)
+} rate_controller_t;
+
 // Estructura para datos de un hilo de trabajo
 typedef struct {
     int thread_id;
@@ -43,19 +83,51 @@ typedef struct {
     FILE *output_fp;
     block_info_t *block_info;
     int *error_flag;
+    int direct_io;            // E/O directa (O_DIRECT) con buffers alineados
+    int input_fd;             // Descriptor compartido en modo directo
+    int output_fd;            // Descriptor compartido en modo directo
+    rate_controller_t *rate_controller; // NULL con nivel fijo
+    block_digest_t *block_hash; // Digest del contenido del bloque (salida al comprimir, esperado con --verify)
+    const block_info_t *base_info; // Bloque equivalente en el archivo base (--base) o NULL
+    const block_digest_t *base_hash; // Digest del bloque en el archivo base
+    int base_fd;              // Descriptor del archivo base
 } thread_data_t;
 
+// Opciones de una operación de compresión/descompresión
+typedef struct {
+    int threads;
+    int block_size;
+    int compression_level;
+    int direct_io;            // Evitar la caché de páginas con O_DIRECT
+    double target_rate;       // MB/s objetivo para el nivel adaptativo (0 = nivel fijo)
+    const char *base_file;    // Archivo .pz previo cuyos bloques sin cambios se reutilizan
+    int shard_index;          // Fragmento a comprimir (1..shard_count)
+    int shard_count;          // Número de fragmentos (0 = archivo completo)
+    int verify;               // Comprobar cada bloque contra su SHA-256 al descomprimir (--verify)
+} parzip_options_t;
+
 // Funciones principales
 int compress_file(const char *input_file, const char *output_file, int threads, int block_size, int compression_level);
 int decompress_file(const char *input_file, const char *output_file, int threads);
+int compress_file_ex(const char *input_file, const char *output_file, const parzip_options_t *opts);
+int decompress_file_ex(const char *input_file, const char *output_file, const parzip_options_t *opts);
+int merge_parzip_files(const char *output_file, char *const *input_files, int num_inputs);
+void parzip_default_options(parzip_options_t *opts);
 int get_cpu_count(void);
 
 // Funciones auxiliares
 void* compress_block_thread(void* arg);
 void* decompress_block_thread(void* arg);
+int is_parzip_magic(uint64_t magic);
+uint32_t parzip_flags(const parzip_header_t *header);
+uint64_t parzip_data_offset(const parzip_header_t *header);
+uint32_t mark_hole_blocks(int fd, const parzip_header_t *header, block_info_t *block_infos);
+void plan_parzip_blocks(const parzip_header_t *header, block_info_t *block_infos, uint32_t alignment);
 int write_parzip_header(FILE *fp, const parzip_header_t *header);
 int read_parzip_header(FILE *fp, parzip_header_t *header);
 int write_parzip_block_info(FILE *fp, const block_info_t *info);
 int read_parzip_block_info(FILE *fp, block_info_t *info);
+int read_parzip_tables(FILE *fp, const parzip_header_t *header, block_info_t *block_infos, block_digest_t *block_hashes);
+int read_parzip_shard_info(FILE *fp, const parzip_header_t *header, parzip_shard_info_t *info);
 
 #endif
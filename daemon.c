@@ -0,0 +1,729 @@
+#define _GNU_SOURCE
+#include "daemon.h"
+#include "compressor.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define DAEMON_BACKLOG 64
+
+// Trabajo de compresión/descompresión recibido de un cliente
+typedef struct daemon_job {
+    int job_id;
+    int type;
+    int input_fd;
+    int output_fd;
+    parzip_header_t header;
+    block_info_t *block_infos;
+    block_digest_t *block_hashes;   // Digests por bloque (solo al comprimir; --verify se procesa localmente)
+    uint32_t next_block;            // Siguiente bloque por despachar
+    uint32_t finished_blocks;       // Bloques terminados (con o sin error)
+    int error_flag;
+    pthread_cond_t done_cond;
+    struct daemon_job *prev, *next; // Anillo de trabajos con bloques pendientes
+} daemon_job_t;
+
+// Estado persistente de cada hilo del pool (streams zlib y buffers reutilizados)
+typedef struct {
+    int worker_id;
+    z_stream deflate_strm;
+    z_stream inflate_strm;
+    int current_level;
+    unsigned char *input_buffer;
+    size_t input_capacity;
+    unsigned char *output_buffer;
+    size_t output_capacity;
+} daemon_worker_t;
+
+// Pool compartido: los bloques se reparten en round-robin entre los trabajos activos
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;
+    daemon_job_t *cursor;   // Trabajo al que le toca el próximo bloque
+    int shutdown;
+    int next_job_id;
+} pool = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, 0, 0 };
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void handle_stop_signal(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+// Crear un hilo que no reciba SIGINT/SIGTERM (solo el hilo principal los atiende)
+static int spawn_thread(pthread_t *tid, void *(*fn)(void*), void *arg) {
+    sigset_t block, old;
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    sigaddset(&block, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &block, &old);
+    int rc = pthread_create(tid, NULL, fn, arg);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    return rc;
+}
+
+// Asegurar que un buffer del worker tenga al menos 'size' bytes
+static int ensure_capacity(unsigned char **buffer, size_t *capacity, size_t size) {
+    if (*capacity >= size) return 0;
+    unsigned char *grown = realloc(*buffer, size);
+    if (!grown) return -1;
+    *buffer = grown;
+    *capacity = size;
+    return 0;
+}
+
+// Operaciones sobre el anillo de trabajos (llamar con pool.mutex tomado)
+static void ring_insert(daemon_job_t *job) {
+    if (!pool.cursor) {
+        job->prev = job->next = job;
+        pool.cursor = job;
+        return;
+    }
+    // Insertar justo antes del cursor: el trabajo nuevo espera su turno
+    job->next = pool.cursor;
+    job->prev = pool.cursor->prev;
+    pool.cursor->prev->next = job;
+    pool.cursor->prev = job;
+}
+
+static void ring_remove(daemon_job_t *job) {
+    if (job->next == job) {
+        pool.cursor = NULL;
+    } else {
+        job->prev->next = job->next;
+        job->next->prev = job->prev;
+        if (pool.cursor == job) pool.cursor = job->next;
+    }
+    job->prev = job->next = NULL;
+}
+
+static int worker_compress_block(daemon_worker_t *w, daemon_job_t *job, block_info_t *info) {
+    uLong bound = compressBound(info->original_size);
+    int level = (int)job->header.compression_level;
+
+    if (info->flags & BLOCK_FLAG_ZERO) return 0; // Hueco del archivo: nada que leer
+
+    if (ensure_capacity(&w->input_buffer, &w->input_capacity, info->original_size) != 0 ||
+        ensure_capacity(&w->output_buffer, &w->output_capacity, bound) != 0) {
+        fprintf(stderr, "Error: No se pudo allocar memoria en worker %d\n", w->worker_id);
+        return -1;
+    }
+
+    off_t file_offset = (off_t)info->block_id * job->header.block_size;
+    if (pread_full(job->input_fd, w->input_buffer, info->original_size, file_offset) != (ssize_t)info->original_size) {
+        fprintf(stderr, "Error: No se pudo leer el bloque %d del trabajo #%d\n", info->block_id, job->job_id);
+        return -1;
+    }
+
+    if (is_zero_block(w->input_buffer, info->original_size)) {
+        info->flags |= BLOCK_FLAG_ZERO;
+        info->compressed_size = 0;
+        return 0;
+    }
+    block_digest(w->input_buffer, info->original_size, &job->block_hashes[info->block_id]);
+
+    // Reutilizar el stream ya inicializado: solo reiniciar y ajustar nivel
+    deflateReset(&w->deflate_strm);
+    if (level != w->current_level) {
+        if (deflateParams(&w->deflate_strm, level, Z_DEFAULT_STRATEGY) != Z_OK) return -1;
+        w->current_level = level;
+    }
+    w->deflate_strm.next_in = w->input_buffer;
+    w->deflate_strm.avail_in = info->original_size;
+    w->deflate_strm.next_out = w->output_buffer;
+    w->deflate_strm.avail_out = bound;
+
+    if (deflate(&w->deflate_strm, Z_FINISH) != Z_STREAM_END) {
+        fprintf(stderr, "Error: Fallo en compresión del bloque %d del trabajo #%d\n", info->block_id, job->job_id);
+        return -1;
+    }
+
+    info->compressed_size = w->deflate_strm.total_out;
+    info->level = (level == Z_DEFAULT_COMPRESSION) ? 6 : level;
+    if (pwrite_full(job->output_fd, w->output_buffer, info->compressed_size, info->offset) != 0) {
+        fprintf(stderr, "Error: No se pudo escribir el bloque comprimido %d\n", info->block_id);
+        return -1;
+    }
+    return 0;
+}
+
+static int worker_decompress_block(daemon_worker_t *w, daemon_job_t *job, block_info_t *info) {
+    if (info->flags & BLOCK_FLAG_ZERO) return 0; // La salida ya tiene un hueco ahí
+
+    if (ensure_capacity(&w->input_buffer, &w->input_capacity, info->compressed_size) != 0 ||
+        ensure_capacity(&w->output_buffer, &w->output_capacity, info->original_size) != 0) {
+        fprintf(stderr, "Error: No se pudo allocar memoria en worker %d\n", w->worker_id);
+        return -1;
+    }
+
+    if (pread_full(job->input_fd, w->input_buffer, info->compressed_size, info->offset) != (ssize_t)info->compressed_size) {
+        fprintf(stderr, "Error: No se pudo leer el bloque comprimido %d del trabajo #%d\n", info->block_id, job->job_id);
+        return -1;
+    }
+
+    inflateReset(&w->inflate_strm);
+    w->inflate_strm.next_in = w->input_buffer;
+    w->inflate_strm.avail_in = info->compressed_size;
+    w->inflate_strm.next_out = w->output_buffer;
+    w->inflate_strm.avail_out = info->original_size;
+
+    if (inflate(&w->inflate_strm, Z_FINISH) != Z_STREAM_END || w->inflate_strm.total_out != info->original_size) {
+        fprintf(stderr, "Error: Fallo en descompresión del bloque %d del trabajo #%d\n", info->block_id, job->job_id);
+        return -1;
+    }
+
+    if (is_zero_block(w->output_buffer, info->original_size)) return 0;
+
+    off_t output_offset = (off_t)info->block_id * job->header.block_size;
+    if (pwrite_full(job->output_fd, w->output_buffer, info->original_size, output_offset) != 0) {
+        fprintf(stderr, "Error: No se pudo escribir el bloque descomprimido %d\n", info->block_id);
+        return -1;
+    }
+    return 0;
+}
+
+// Hilo del pool: toma bloques de los trabajos activos por turnos
+static void* worker_thread(void* arg) {
+    daemon_worker_t *w = (daemon_worker_t*)arg;
+
+    pthread_mutex_lock(&pool.mutex);
+    for (;;) {
+        while (!pool.cursor && !pool.shutdown) {
+            pthread_cond_wait(&pool.work_cond, &pool.mutex);
+        }
+        if (!pool.cursor) break; // Apagado y sin trabajo pendiente
+
+        daemon_job_t *job = pool.cursor;
+        block_info_t *info = &job->block_infos[job->next_block++];
+        if (job->next_block == job->header.num_blocks) {
+            ring_remove(job);
+        } else {
+            pool.cursor = job->next;
+        }
+        int skip = job->error_flag;
+        pthread_mutex_unlock(&pool.mutex);
+
+        int rc = 0;
+        if (!skip) {
+            rc = (job->type == DAEMON_JOB_COMPRESS) ? worker_compress_block(w, job, info)
+                                                    : worker_decompress_block(w, job, info);
+        }
+
+        pthread_mutex_lock(&pool.mutex);
+        if (rc != 0) job->error_flag = 1;
+        if (++job->finished_blocks == job->header.num_blocks) {
+            pthread_cond_signal(&job->done_cond);
+        }
+    }
+    pthread_mutex_unlock(&pool.mutex);
+    return NULL;
+}
+
+// Encolar el trabajo en el pool y esperar a que terminen todos sus bloques
+static void run_job(daemon_job_t *job) {
+    if (job->header.num_blocks == 0) return;
+
+    pthread_mutex_lock(&pool.mutex);
+    ring_insert(job);
+    pthread_cond_broadcast(&pool.work_cond);
+    while (job->finished_blocks < job->header.num_blocks) {
+        pthread_cond_wait(&job->done_cond, &pool.mutex);
+    }
+    pthread_mutex_unlock(&pool.mutex);
+}
+
+static int prepare_compress_job(daemon_job_t *job, const daemon_request_t *req) {
+    struct stat file_stat;
+
+    // El daemon no confía en el cliente: validar igual que la línea de comandos
+    if (validate_block_size(req->block_size) != 0 || fstat(job->input_fd, &file_stat) != 0) {
+        return -1;
+    }
+    if (req->compression_level != Z_DEFAULT_COMPRESSION && validate_compression_level(req->compression_level) != 0) {
+        return -1;
+    }
+
+    memset(&job->header, 0, sizeof(job->header));
+    job->header.magic = MAGIC_NUMBER_V2;
+    job->header.flags = PARZIP_FLAG_BLOCK_HASHES;
+    job->header.block_size = req->block_size;
+    job->header.num_blocks = (file_stat.st_size + req->block_size - 1) / req->block_size;
+    job->header.compression_level = req->compression_level;
+    job->header.original_size = file_stat.st_size;
+
+    job->block_infos = calloc(job->header.num_blocks ? job->header.num_blocks : 1, sizeof(block_info_t));
+    job->block_hashes = calloc(job->header.num_blocks ? job->header.num_blocks : 1, sizeof(block_digest_t));
+    if (!job->block_infos || !job->block_hashes) return -1;
+    mark_hole_blocks(job->input_fd, &job->header, job->block_infos);
+    plan_parzip_blocks(&job->header, job->block_infos, 1);
+    return 0;
+}
+
+static int finish_compress_job(daemon_job_t *job) {
+    size_t table_size = (size_t)job->header.num_blocks * sizeof(block_info_t);
+    if (pwrite_full(job->output_fd, &job->header, sizeof(parzip_header_t), 0) != 0 ||
+        pwrite_full(job->output_fd, job->block_infos, table_size, sizeof(parzip_header_t)) != 0 ||
+        pwrite_full(job->output_fd, job->block_hashes, (size_t)job->header.num_blocks * sizeof(block_digest_t),
+                    sizeof(parzip_header_t) + table_size) != 0) {
+        fprintf(stderr, "Error: No se pudo escribir el header del trabajo #%d\n", job->job_id);
+        return -1;
+    }
+    return 0;
+}
+
+static int prepare_decompress_job(daemon_job_t *job) {
+    if (pread_full(job->input_fd, &job->header, sizeof(parzip_header_t), 0) != sizeof(parzip_header_t) ||
+        !is_parzip_magic(job->header.magic)) {
+        fprintf(stderr, "Error: El trabajo #%d no es un archivo .pz válido\n", job->job_id);
+        return -1;
+    }
+    if (parzip_flags(&job->header) & PARZIP_FLAG_PARTIAL) {
+        fprintf(stderr, "Error: El trabajo #%d es un fragmento sin unir (--merge)\n", job->job_id);
+        return -1;
+    }
+
+    size_t table_size = (size_t)job->header.num_blocks * sizeof(block_info_t);
+    job->block_infos = malloc(table_size ? table_size : 1);
+    if (!job->block_infos) return -1;
+    if (pread_full(job->input_fd, job->block_infos, table_size, sizeof(parzip_header_t)) != (ssize_t)table_size) {
+        fprintf(stderr, "Error: No se pudo leer la tabla de bloques del trabajo #%d\n", job->job_id);
+        return -1;
+    }
+
+    // Pre-allocar el archivo de salida al tamaño completo
+    if (ftruncate(job->output_fd, job->header.original_size) != 0) {
+        fprintf(stderr, "Error: No se pudo pre-allocar la salida del trabajo #%d\n", job->job_id);
+        return -1;
+    }
+    return 0;
+}
+
+// Recibir la petición junto con los descriptores de entrada y salida
+static int receive_request(int conn, daemon_request_t *req, int *input_fd, int *output_fd) {
+    union {
+        char buf[CMSG_SPACE(2 * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = { req, sizeof(*req) };
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    ssize_t n = recvmsg(conn, &msg, MSG_CMSG_CLOEXEC);
+
+    // Recoger todos los descriptores recibidos (SCM_RIGHTS) aunque la petición sea inválida:
+    // los que no pasan al trabajo se cierran, el daemon no puede acumularlos
+    int fds[2];
+    int num_fds = 0, extra_fds = 0;
+    if (n >= 0) {
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+            size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (size_t i = 0; i < count; i++) {
+                int fd;
+                memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+                if (num_fds < 2) {
+                    fds[num_fds++] = fd;
+                } else {
+                    close(fd);
+                    extra_fds++;
+                }
+            }
+        }
+    }
+
+    if (n != sizeof(*req) || num_fds != 2 || extra_fds || (msg.msg_flags & MSG_CTRUNC) ||
+        req->magic != DAEMON_REQUEST_MAGIC) {
+        for (int i = 0; i < num_fds; i++) close(fds[i]);
+        return -1;
+    }
+
+    *input_fd = fds[0];
+    *output_fd = fds[1];
+    return 0;
+}
+
+// Hilo que atiende una conexión de cliente
+static void* client_thread(void* arg) {
+    int conn = (int)(intptr_t)arg;
+    daemon_request_t req;
+    daemon_response_t resp;
+    daemon_job_t job;
+    int rc = -1;
+
+    memset(&job, 0, sizeof(job));
+    memset(&resp, 0, sizeof(resp));
+    job.input_fd = job.output_fd = -1;
+    pthread_cond_init(&job.done_cond, NULL);
+
+    if (receive_request(conn, &req, &job.input_fd, &job.output_fd) != 0) {
+        fprintf(stderr, "Error: Petición inválida recibida por el socket\n");
+        goto cleanup;
+    }
+
+    pthread_mutex_lock(&pool.mutex);
+    job.job_id = ++pool.next_job_id;
+    pthread_mutex_unlock(&pool.mutex);
+    job.type = req.type;
+
+    if (req.type == DAEMON_JOB_COMPRESS) {
+        rc = prepare_compress_job(&job, &req);
+    } else if (req.type == DAEMON_JOB_DECOMPRESS) {
+        rc = prepare_decompress_job(&job);
+    }
+    if (rc != 0) goto cleanup;
+
+    printf("📥 Trabajo #%d: %s de %lu bytes (%u bloques)\n", job.job_id,
+           job.type == DAEMON_JOB_COMPRESS ? "compresión" : "descompresión",
+           (unsigned long)job.header.original_size, job.header.num_blocks);
+
+    run_job(&job);
+    rc = job.error_flag ? -1 : 0;
+    if (rc == 0 && job.type == DAEMON_JOB_COMPRESS) {
+        rc = finish_compress_job(&job);
+    }
+
+    resp.num_blocks = job.header.num_blocks;
+    resp.original_size = job.header.original_size;
+    for (uint32_t i = 0; i < job.header.num_blocks; i++) {
+        resp.compressed_size += job.block_infos[i].compressed_size;
+    }
+    printf("%s Trabajo #%d %s\n", rc == 0 ? "✅" : "❌", job.job_id, rc == 0 ? "completado" : "falló");
+
+cleanup:
+    resp.status = rc;
+    if (send(conn, &resp, sizeof(resp), MSG_NOSIGNAL) != sizeof(resp)) {
+        fprintf(stderr, "Advertencia: No se pudo enviar la respuesta al cliente\n");
+    }
+    if (job.input_fd >= 0) close(job.input_fd);
+    if (job.output_fd >= 0) close(job.output_fd);
+    if (job.block_infos) free(job.block_infos);
+    if (job.block_hashes) free(job.block_hashes);
+    pthread_cond_destroy(&job.done_cond);
+    close(conn);
+    return NULL;
+}
+
+static int fill_socket_address(struct sockaddr_un *addr, const char *socket_path) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr->sun_path)) {
+        fprintf(stderr, "Error: Ruta de socket demasiado larga: %s\n", socket_path);
+        return -1;
+    }
+    strcpy(addr->sun_path, socket_path);
+    return 0;
+}
+
+// Verificar que el proceso al otro lado del socket sea del mismo usuario (SO_PEERCRED)
+static int peer_is_same_user(int sock) {
+    struct ucred cred;
+    socklen_t cred_len = sizeof(cred);
+    if (getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) != 0 || cred_len != sizeof(cred)) {
+        return 0;
+    }
+    return cred.uid == getuid();
+}
+
+// Directorio privado por usuario cuando no hay $XDG_RUNTIME_DIR
+static int private_socket_dir(char *buf, size_t len) {
+    int n = snprintf(buf, len, "/tmp/parzip-%u", (unsigned)getuid());
+    return (n > 0 && (size_t)n < len) ? 0 : -1;
+}
+
+// Crear (o validar) el directorio privado: debe ser un directorio propio con permisos 0700
+static int ensure_private_dir(const char *dir) {
+    struct stat st;
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Error: No se pudo crear el directorio %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+    if (lstat(dir, &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != getuid() || (st.st_mode & 0077) != 0) {
+        fprintf(stderr, "Error: %s no es un directorio privado del usuario actual (se esperaba 0700)\n", dir);
+        return -1;
+    }
+    return 0;
+}
+
+// Borrar un socket anterior solo si es realmente un socket del usuario actual
+static int remove_stale_socket(const char *socket_path) {
+    struct stat st;
+    if (lstat(socket_path, &st) != 0) {
+        return errno == ENOENT ? 0 : -1;
+    }
+    if (!S_ISSOCK(st.st_mode) || st.st_uid != getuid()) {
+        fprintf(stderr, "Error: %s existe y no es un socket del usuario actual; no se borrará\n", socket_path);
+        return -1;
+    }
+    return unlink(socket_path);
+}
+
+// Ruta del socket: $PARZIP_SOCKET, $XDG_RUNTIME_DIR/parzip.sock o /tmp/parzip-<uid>/daemon.sock
+int daemon_socket_path(char *buf, size_t len) {
+    const char *env = getenv(DAEMON_SOCKET_ENV);
+    const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+    char dir[64];
+    int n;
+
+    if (env && *env) {
+        n = snprintf(buf, len, "%s", env);
+    } else if (runtime_dir && *runtime_dir) {
+        n = snprintf(buf, len, "%s/parzip.sock", runtime_dir);
+    } else {
+        if (private_socket_dir(dir, sizeof(dir)) != 0) return -1;
+        n = snprintf(buf, len, "%s/daemon.sock", dir);
+    }
+    return (n > 0 && (size_t)n < len) ? 0 : -1;
+}
+
+// Daemon residente: pool de hilos caliente atendiendo trabajos por el socket
+int run_daemon(const char *socket_path, int threads) {
+    struct sockaddr_un addr;
+    struct stat socket_stat;
+    daemon_worker_t *workers = NULL;
+    pthread_t *worker_ids = NULL;
+    char dir[64];
+    int started = 0;
+    int listen_fd = -1;
+    int result = 0;
+
+    if (fill_socket_address(&addr, socket_path) != 0) return -1;
+
+    // La ruta por defecto sin $XDG_RUNTIME_DIR vive en un directorio 0700 propio
+    if (private_socket_dir(dir, sizeof(dir)) == 0 && strncmp(socket_path, dir, strlen(dir)) == 0 &&
+        socket_path[strlen(dir)] == '/' && ensure_private_dir(dir) != 0) {
+        return -1;
+    }
+
+    // Detectar otro daemon activo antes de borrar un socket huérfano
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        fprintf(stderr, "Error: No se pudo crear el socket: %s\n", strerror(errno));
+        return -1;
+    }
+    if (connect(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+        fprintf(stderr, "Error: Ya hay un daemon escuchando en %s\n", socket_path);
+        close(listen_fd);
+        return -1;
+    }
+    close(listen_fd);
+    if (remove_stale_socket(socket_path) != 0) return -1;
+
+    // El socket se crea ya con permisos 0600 (umask), sin ventana en la que otros puedan conectarse
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    mode_t old_umask = umask(0077);
+    int bound = listen_fd >= 0 && bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+    umask(old_umask);
+    if (!bound || listen(listen_fd, DAEMON_BACKLOG) != 0 || lstat(socket_path, &socket_stat) != 0) {
+        fprintf(stderr, "Error: No se pudo escuchar en %s: %s\n", socket_path, strerror(errno));
+        if (listen_fd >= 0) close(listen_fd);
+        return -1;
+    }
+
+    // SIGINT/SIGTERM interrumpen accept() para apagar limpiamente
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_stop_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    workers = calloc(threads, sizeof(daemon_worker_t));
+    worker_ids = calloc(threads, sizeof(pthread_t));
+    if (!workers || !worker_ids) {
+        fprintf(stderr, "Error: No se pudo allocar memoria\n");
+        result = -1;
+        goto cleanup;
+    }
+
+    // Inicializar streams y buffers una sola vez por worker
+    for (int t = 0; t < threads; t++) {
+        daemon_worker_t *w = &workers[t];
+        w->worker_id = t;
+        w->current_level = Z_DEFAULT_COMPRESSION;
+        if (deflateInit(&w->deflate_strm, Z_DEFAULT_COMPRESSION) != Z_OK ||
+            inflateInit(&w->inflate_strm) != Z_OK ||
+            ensure_capacity(&w->input_buffer, &w->input_capacity, DEFAULT_BLOCK_SIZE) != 0 ||
+            ensure_capacity(&w->output_buffer, &w->output_capacity, compressBound(DEFAULT_BLOCK_SIZE)) != 0) {
+            fprintf(stderr, "Error: No se pudo inicializar el worker %d\n", t);
+            result = -1;
+            goto cleanup;
+        }
+        if (spawn_thread(&worker_ids[t], worker_thread, w) != 0) {
+            fprintf(stderr, "Error: No se pudo crear el hilo %d\n", t);
+            result = -1;
+            goto cleanup;
+        }
+        started++;
+    }
+
+    printf("🛰️ Daemon ParZip escuchando en %s\n", socket_path);
+    printf("🧵 Pool de hilos: %d\n", threads);
+    fflush(stdout);
+
+    while (!stop_requested) {
+        int conn = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (conn < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "Error: accept falló: %s\n", strerror(errno));
+            result = -1;
+            break;
+        }
+
+        // Solo se aceptan trabajos del mismo usuario: los descriptores recibidos se usan con sus permisos
+        if (!peer_is_same_user(conn)) {
+            fprintf(stderr, "Advertencia: Conexión rechazada de otro usuario\n");
+            close(conn);
+            continue;
+        }
+
+        pthread_t tid;
+        if (spawn_thread(&tid, client_thread, (void*)(intptr_t)conn) != 0) {
+            fprintf(stderr, "Error: No se pudo crear el hilo del cliente\n");
+            close(conn);
+            continue;
+        }
+        pthread_detach(tid);
+    }
+
+    printf("\n🛑 Apagando daemon...\n");
+
+cleanup:
+    pthread_mutex_lock(&pool.mutex);
+    pool.shutdown = 1;
+    pthread_cond_broadcast(&pool.work_cond);
+    pthread_mutex_unlock(&pool.mutex);
+    for (int t = 0; t < started; t++) {
+        pthread_join(worker_ids[t], NULL);
+    }
+    if (workers) {
+        for (int t = 0; t < threads; t++) {
+            deflateEnd(&workers[t].deflate_strm);
+            inflateEnd(&workers[t].inflate_strm);
+            free(workers[t].input_buffer);
+            free(workers[t].output_buffer);
+        }
+        free(workers);
+    }
+    if (worker_ids) free(worker_ids);
+    close(listen_fd);
+
+    // Borrar el socket solo si sigue siendo el que creó este daemon
+    struct stat current;
+    if (lstat(socket_path, &current) == 0 && S_ISSOCK(current.st_mode) &&
+        current.st_dev == socket_stat.st_dev && current.st_ino == socket_stat.st_ino) {
+        unlink(socket_path);
+    }
+
+    return result;
+}
+
+// Enviar un trabajo al daemon; devuelve DAEMON_UNAVAILABLE si no hay daemon escuchando
+int daemon_submit(const char *socket_path, int type, const char *input_file, const char *output_file,
+                  int block_size, int compression_level) {
+    struct sockaddr_un addr;
+    daemon_request_t req;
+    daemon_response_t resp;
+    int sock = -1, input_fd = -1, output_fd = -1;
+    int result = -1;
+
+    if (fill_socket_address(&addr, socket_path) != 0) return DAEMON_UNAVAILABLE;
+
+    sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) return DAEMON_UNAVAILABLE;
+    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(sock);
+        return DAEMON_UNAVAILABLE;
+    }
+
+    // No entregar descriptores a un proceso de otro usuario que ocupe la ruta del socket
+    if (!peer_is_same_user(sock)) {
+        fprintf(stderr, "⚠️  El socket %s pertenece a otro usuario; se ignora y se procesa localmente\n", socket_path);
+        close(sock);
+        return DAEMON_UNAVAILABLE;
+    }
+
+    printf("🔌 Usando daemon en %s\n", socket_path);
+
+    input_fd = open(input_file, O_RDONLY | O_CLOEXEC);
+    output_fd = open(output_file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (input_fd < 0 || output_fd < 0) {
+        fprintf(stderr, "Error: No se pudieron abrir los archivos\n");
+        goto cleanup;
+    }
+
+    // Enviar la petición con ambos descriptores (SCM_RIGHTS)
+    union {
+        char buf[CMSG_SPACE(2 * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = { &req, sizeof(req) };
+    struct msghdr msg;
+    int fds[2] = { input_fd, output_fd };
+
+    memset(&req, 0, sizeof(req));
+    req.magic = DAEMON_REQUEST_MAGIC;
+    req.type = type;
+    req.block_size = block_size;
+    req.compression_level = compression_level;
+
+    memset(&msg, 0, sizeof(msg));
+    memset(&control, 0, sizeof(control));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    if (sendmsg(sock, &msg, MSG_NOSIGNAL) != sizeof(req)) {
+        fprintf(stderr, "Error: No se pudo enviar el trabajo al daemon: %s\n", strerror(errno));
+        goto cleanup;
+    }
+
+    if (recv(sock, &resp, sizeof(resp), MSG_WAITALL) != sizeof(resp)) {
+        fprintf(stderr, "Error: El daemon cerró la conexión sin responder\n");
+        goto cleanup;
+    }
+
+    if (resp.status != 0) {
+        fprintf(stderr, "❌ El daemon reportó un error procesando el trabajo\n");
+        goto cleanup;
+    }
+
+    if (type == DAEMON_JOB_COMPRESS) {
+        printf("\n✅ Compresión completada exitosamente!\n");
+        printf("📊 Tamaño original: %lu bytes\n", (unsigned long)resp.original_size);
+        printf("📦 Tamaño comprimido: %lu bytes\n", (unsigned long)resp.compressed_size);
+        if (resp.original_size > 0) {
+            printf("💾 Reducción: %.2f%%\n", 100.0 * (1.0 - (double)resp.compressed_size / resp.original_size));
+        }
+    } else {
+        printf("\n✅ Descompresión completada exitosamente!\n");
+        printf("📁 Archivo recuperado: %s (%lu bytes)\n", output_file, (unsigned long)resp.original_size);
+    }
+    result = 0;
+
+cleanup:
+    if (input_fd >= 0) close(input_fd);
+    if (output_fd >= 0) close(output_fd);
+    close(sock);
+    return result;
+}
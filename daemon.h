@@ -0,0 +1,37 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DAEMON_SOCKET_ENV "PARZIP_SOCKET"   // Variable de entorno con la ruta del socket
+#define DAEMON_REQUEST_MAGIC 0x505A4A42U     // "PZJB"
+#define DAEMON_UNAVAILABLE 1                 // No hay daemon escuchando: usar modo local
+
+// Tipos de trabajo aceptados por el daemon
+#define DAEMON_JOB_COMPRESS   1
+#define DAEMON_JOB_DECOMPRESS 2
+
+// Petición enviada por el cliente (los descriptores viajan aparte con SCM_RIGHTS)
+typedef struct {
+    uint32_t magic;             // DAEMON_REQUEST_MAGIC
+    uint32_t type;              // DAEMON_JOB_COMPRESS o DAEMON_JOB_DECOMPRESS
+    uint32_t block_size;        // Tamaño de bloque (solo compresión)
+    int32_t compression_level;  // Nivel de compresión (solo compresión)
+} daemon_request_t;
+
+// Respuesta del daemon al terminar el trabajo
+typedef struct {
+    int32_t status;             // 0 si el trabajo terminó correctamente
+    uint32_t num_blocks;        // Bloques procesados
+    uint64_t original_size;     // Tamaño sin comprimir
+    uint64_t compressed_size;   // Suma de los bloques comprimidos
+} daemon_response_t;
+
+// Funciones principales
+int daemon_socket_path(char *buf, size_t len);
+int run_daemon(const char *socket_path, int threads);
+int daemon_submit(const char *socket_path, int type, const char *input_file, const char *output_file,
+                  int block_size, int compression_level);
+
+#endif
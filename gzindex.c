@@ -0,0 +1,613 @@
+#define _GNU_SOURCE
+#include "gzindex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#define GZ_CHUNK 65536  // Tamaño de lectura del .gz
+
+// Datos de un hilo que descomprime un segmento entre dos puntos de acceso
+typedef struct {
+    int thread_id;
+    int segment_id;
+    const char *gz_file;
+    const gz_access_point_t *point;
+    uint64_t length;
+    uint32_t crc;                 // CRC-32 del segmento descomprimido
+    FILE *output_fp;
+    pthread_mutex_t *output_mutex;
+    int *error_flag;
+} gz_segment_task_t;
+
+// Detectar un archivo gzip por sus bytes mágicos (1f 8b)
+int is_gzip_file(const char *filename) {
+    unsigned char magic[2];
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) return 0;
+    size_t n = fread(magic, 1, sizeof(magic), fp);
+    fclose(fp);
+    return n == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+}
+
+int gz_index_path(const char *gz_file, char *buf, size_t len) {
+    int n = snprintf(buf, len, "%s%s", gz_file, GZ_INDEX_SUFFIX);
+    return (n > 0 && (size_t)n < len) ? 0 : -1;
+}
+
+void gz_index_free(gz_index_t *index) {
+    if (!index) return;
+    for (uint32_t i = 0; i < index->num_points; i++) {
+        free(index->points[i].window);
+    }
+    free(index->points);
+    index->points = NULL;
+    index->num_points = 0;
+}
+
+// Registrar un punto de acceso copiando la ventana circular en orden
+static int add_access_point(gz_index_t *index, uint32_t *capacity, int bits, uint64_t in, uint64_t out,
+                            unsigned left, const unsigned char *window) {
+    unsigned char ordered[GZ_WINDOW_SIZE];
+
+    if (index->num_points == *capacity) {
+        uint32_t grown = *capacity ? *capacity * 2 : 16;
+        gz_access_point_t *points = realloc(index->points, grown * sizeof(gz_access_point_t));
+        if (!points) return -1;
+        index->points = points;
+        *capacity = grown;
+    }
+
+    gz_access_point_t *point = &index->points[index->num_points];
+    point->out = out;
+    point->in = in;
+    point->bits = bits;
+    point->window_size = out < GZ_WINDOW_SIZE ? (uint32_t)out : GZ_WINDOW_SIZE;
+    point->window = malloc(point->window_size ? point->window_size : 1);
+    if (!point->window) return -1;
+
+    if (left) memcpy(ordered, window + GZ_WINDOW_SIZE - left, left);
+    if (left < GZ_WINDOW_SIZE) memcpy(ordered + left, window, GZ_WINDOW_SIZE - left);
+    memcpy(point->window, ordered + GZ_WINDOW_SIZE - point->window_size, point->window_size);
+
+    index->num_points++;
+    return 0;
+}
+
+// Recorrer el .gz una vez registrando un punto de acceso cada 'span' bytes descomprimidos
+int gz_index_build(const char *gz_file, uint32_t span, gz_index_t *index) {
+    FILE *fp = NULL;
+    struct stat file_stat;
+    z_stream strm;
+    unsigned char *input = NULL;
+    unsigned char *window = NULL;
+    uint64_t totin = 0, totout = 0, last = 0;
+    uint32_t capacity = 0;
+    int ret = Z_OK;
+    int result = -1;
+
+    memset(index, 0, sizeof(*index));
+    memset(&strm, 0, sizeof(strm));
+    index->span = span;
+
+    if (stat(gz_file, &file_stat) != 0) {
+        fprintf(stderr, "Error: No se pudo obtener información del archivo: %s\n", strerror(errno));
+        return -1;
+    }
+    index->gz_size = file_stat.st_size;
+    index->gz_mtime = file_stat.st_mtime;
+
+    fp = fopen(gz_file, "rb");
+    input = malloc(GZ_CHUNK);
+    window = malloc(GZ_WINDOW_SIZE);
+    if (!fp || !input || !window) {
+        fprintf(stderr, "Error: No se pudo abrir %s o allocar memoria\n", gz_file);
+        goto cleanup;
+    }
+
+    if (inflateInit2(&strm, 31) != Z_OK) { // 15 + 16: solo formato gzip
+        fprintf(stderr, "Error: No se pudo inicializar zlib\n");
+        goto cleanup;
+    }
+
+    strm.avail_out = 0;
+    do {
+        strm.avail_in = fread(input, 1, GZ_CHUNK, fp);
+        if (ferror(fp) || strm.avail_in == 0) {
+            fprintf(stderr, "Error: El archivo gzip está truncado o no se pudo leer\n");
+            goto cleanup_stream;
+        }
+        strm.next_in = input;
+
+        do {
+            // La ventana es circular: al llenarse se reinicia desde el principio
+            if (strm.avail_out == 0) {
+                strm.avail_out = GZ_WINDOW_SIZE;
+                strm.next_out = window;
+            }
+
+            totin += strm.avail_in;
+            totout += strm.avail_out;
+            ret = inflate(&strm, Z_BLOCK);
+            totin -= strm.avail_in;
+            totout -= strm.avail_out;
+
+            if (ret == Z_NEED_DICT) ret = Z_DATA_ERROR;
+            if (ret == Z_MEM_ERROR || ret == Z_DATA_ERROR) {
+                fprintf(stderr, "Error: Datos gzip inválidos (código: %d)\n", ret);
+                goto cleanup_stream;
+            }
+            if (ret == Z_STREAM_END) break;
+
+            // Fin de un bloque deflate (no el último): candidato a punto de acceso
+            if ((strm.data_type & 128) && !(strm.data_type & 64) &&
+                (index->num_points == 0 || totout - last > span)) {
+                if (add_access_point(index, &capacity, strm.data_type & 7, totin, totout,
+                                     strm.avail_out, window) != 0) {
+                    fprintf(stderr, "Error: No se pudo allocar memoria para el índice\n");
+                    goto cleanup_stream;
+                }
+                last = totout;
+            }
+        } while (strm.avail_in != 0);
+    } while (ret != Z_STREAM_END);
+
+    // Solo se soportan archivos de un único miembro gzip
+    if (strm.avail_in != 0 || fgetc(fp) != EOF) {
+        fprintf(stderr, "Error: El archivo contiene varios miembros gzip o datos extra (no soportado)\n");
+        goto cleanup_stream;
+    }
+
+    index->original_size = totout;
+    result = 0;
+
+cleanup_stream:
+    inflateEnd(&strm);
+cleanup:
+    if (fp) fclose(fp);
+    if (input) free(input);
+    if (window) free(window);
+    if (result != 0) gz_index_free(index);
+    return result;
+}
+
+int gz_index_save(const gz_index_t *index, const char *index_file) {
+    gz_index_header_t header;
+    unsigned char *stored = NULL;
+    int result = -1;
+
+    FILE *fp = fopen(index_file, "wb");
+    stored = malloc(compressBound(GZ_WINDOW_SIZE));
+    if (!fp || !stored) goto cleanup;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = GZ_INDEX_MAGIC;
+    header.num_points = index->num_points;
+    header.span = index->span;
+    header.gz_size = index->gz_size;
+    header.gz_mtime = index->gz_mtime;
+    header.original_size = index->original_size;
+    if (fwrite(&header, sizeof(header), 1, fp) != 1) goto cleanup;
+
+    // Las ventanas se guardan comprimidas para que el índice ocupe poco
+    for (uint32_t i = 0; i < index->num_points; i++) {
+        const gz_access_point_t *point = &index->points[i];
+        gz_point_record_t record;
+        uLongf stored_size = compressBound(GZ_WINDOW_SIZE);
+
+        if (compress2(stored, &stored_size, point->window, point->window_size, Z_BEST_COMPRESSION) != Z_OK) goto cleanup;
+
+        memset(&record, 0, sizeof(record));
+        record.out = point->out;
+        record.in = point->in;
+        record.bits = point->bits;
+        record.window_size = point->window_size;
+        record.stored_size = stored_size;
+        if (fwrite(&record, sizeof(record), 1, fp) != 1 || fwrite(stored, 1, stored_size, fp) != stored_size) goto cleanup;
+    }
+    result = 0;
+
+cleanup:
+    if (fp && fclose(fp) != 0) result = -1;
+    if (stored) free(stored);
+    return result;
+}
+
+int gz_index_load(const char *index_file, gz_index_t *index) {
+    gz_index_header_t header;
+    unsigned char *stored = NULL;
+    int result = -1;
+
+    memset(index, 0, sizeof(*index));
+    FILE *fp = fopen(index_file, "rb");
+    if (!fp) return -1;
+
+    if (fread(&header, sizeof(header), 1, fp) != 1 || header.magic != GZ_INDEX_MAGIC || header.num_points == 0) goto cleanup;
+
+    index->points = calloc(header.num_points, sizeof(gz_access_point_t));
+    stored = malloc(compressBound(GZ_WINDOW_SIZE));
+    if (!index->points || !stored) goto cleanup;
+
+    index->span = header.span;
+    index->gz_size = header.gz_size;
+    index->gz_mtime = header.gz_mtime;
+    index->original_size = header.original_size;
+
+    for (uint32_t i = 0; i < header.num_points; i++) {
+        gz_access_point_t *point = &index->points[i];
+        gz_point_record_t record;
+
+        if (fread(&record, sizeof(record), 1, fp) != 1 || record.window_size > GZ_WINDOW_SIZE ||
+            record.stored_size > compressBound(GZ_WINDOW_SIZE) || record.bits > 7 ||
+            fread(stored, 1, record.stored_size, fp) != record.stored_size) goto cleanup;
+
+        point->out = record.out;
+        point->in = record.in;
+        point->bits = record.bits;
+        point->window_size = record.window_size;
+        point->window = malloc(record.window_size ? record.window_size : 1);
+        index->num_points++;
+        if (!point->window) goto cleanup;
+
+        uLongf window_size = record.window_size;
+        if (uncompress(point->window, &window_size, stored, record.stored_size) != Z_OK ||
+            window_size != record.window_size) goto cleanup;
+    }
+    result = 0;
+
+cleanup:
+    fclose(fp);
+    if (stored) free(stored);
+    if (result != 0) gz_index_free(index);
+    return result;
+}
+
+// Cargar el índice si existe y corresponde al .gz actual; si no, construirlo y guardarlo
+static int obtain_index(const char *gz_file, gz_index_t *index) {
+    char index_file[4096];
+    struct stat file_stat;
+
+    if (gz_index_path(gz_file, index_file, sizeof(index_file)) != 0 || stat(gz_file, &file_stat) != 0) {
+        fprintf(stderr, "Error: No se pudo acceder a %s\n", gz_file);
+        return -1;
+    }
+
+    if (gz_index_load(index_file, index) == 0) {
+        if (index->gz_size == (uint64_t)file_stat.st_size && index->gz_mtime == (uint64_t)file_stat.st_mtime) {
+            printf("📇 Usando índice existente: %s (%u puntos de acceso)\n", index_file, index->num_points);
+            return 0;
+        }
+        printf("⚠️  El índice %s está desactualizado, se reconstruirá\n", index_file);
+        gz_index_free(index);
+    }
+
+    printf("📇 Construyendo índice de puntos de acceso (una pasada secuencial)...\n");
+    if (gz_index_build(gz_file, GZ_INDEX_SPAN, index) != 0) return -1;
+
+    if (gz_index_save(index, index_file) != 0) {
+        fprintf(stderr, "Advertencia: No se pudo guardar el índice en %s\n", index_file);
+    } else {
+        printf("💾 Índice guardado en %s (%u puntos de acceso)\n", index_file, index->num_points);
+    }
+    return 0;
+}
+
+// Inflar desde un punto de acceso: descarta 'skip' bytes y entrega 'length' bytes
+// en 'out' o, si 'out' es NULL, los escribe en 'sink'. Devuelve los bytes entregados o -1.
+static int64_t inflate_from_point(FILE *fp, const gz_access_point_t *point, uint64_t skip,
+                                  unsigned char *out, FILE *sink, uint64_t length) {
+    unsigned char input[GZ_CHUNK];
+    unsigned char scratch[GZ_CHUNK];
+    uint64_t produced = 0;
+    z_stream strm;
+    int ret = Z_OK;
+
+    memset(&strm, 0, sizeof(strm));
+    if (inflateInit2(&strm, -15) != Z_OK) return -1; // deflate crudo
+
+    if (fseeko(fp, point->in - (point->bits ? 1 : 0), SEEK_SET) != 0) goto fail;
+    if (point->bits) {
+        int ch = getc(fp);
+        if (ch == EOF) goto fail;
+        inflatePrime(&strm, point->bits, ch >> (8 - point->bits));
+    }
+    if (point->window_size) {
+        inflateSetDictionary(&strm, point->window, point->window_size);
+    }
+
+    while (produced < length && ret != Z_STREAM_END) {
+        if (strm.avail_in == 0) {
+            strm.avail_in = fread(input, 1, sizeof(input), fp);
+            if (strm.avail_in == 0) break;
+            strm.next_in = input;
+        }
+
+        unsigned char *dest;
+        uInt room;
+        if (skip) {
+            dest = scratch;
+            room = skip < sizeof(scratch) ? (uInt)skip : sizeof(scratch);
+        } else if (out) {
+            dest = out + produced;
+            room = (length - produced) < (1U << 30) ? (uInt)(length - produced) : (1U << 30);
+        } else {
+            dest = scratch;
+            room = (length - produced) < sizeof(scratch) ? (uInt)(length - produced) : sizeof(scratch);
+        }
+
+        strm.next_out = dest;
+        strm.avail_out = room;
+        ret = inflate(&strm, Z_NO_FLUSH);
+        if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR) goto fail;
+
+        uInt got = room - strm.avail_out;
+        if (skip) {
+            skip -= got;
+        } else {
+            if (!out && fwrite(scratch, 1, got, sink) != got) goto fail;
+            produced += got;
+        }
+    }
+
+    inflateEnd(&strm);
+    return produced;
+
+fail:
+    inflateEnd(&strm);
+    return -1;
+}
+
+// Función del hilo para descomprimir un segmento del .gz
+static void* gz_segment_thread(void* arg) {
+    gz_segment_task_t *task = (gz_segment_task_t*)arg;
+    unsigned char *output_buffer = NULL;
+    FILE *input_fp = NULL;
+
+    input_fp = fopen(task->gz_file, "rb");
+    output_buffer = malloc(task->length ? task->length : 1);
+    if (!input_fp || !output_buffer) {
+        fprintf(stderr, "Error: No se pudo abrir el archivo o allocar memoria en hilo %d\n", task->thread_id);
+        *task->error_flag = 1;
+        goto cleanup;
+    }
+
+    if (inflate_from_point(input_fp, task->point, 0, output_buffer, NULL, task->length) != (int64_t)task->length) {
+        fprintf(stderr, "Error: Fallo en descompresión del segmento %d en hilo %d\n", task->segment_id, task->thread_id);
+        *task->error_flag = 1;
+        goto cleanup;
+    }
+
+    // Con inflate crudo zlib no comprueba el trailer: cada segmento aporta su CRC-32
+    task->crc = crc32_z(crc32(0L, Z_NULL, 0), output_buffer, task->length);
+
+    // Escribir segmento descomprimido al archivo de salida (con mutex)
+    pthread_mutex_lock(task->output_mutex);
+    fseeko(task->output_fp, task->point->out, SEEK_SET);
+    if (fwrite(output_buffer, 1, task->length, task->output_fp) != task->length) {
+        fprintf(stderr, "Error: No se pudo escribir el segmento %d\n", task->segment_id);
+        *task->error_flag = 1;
+    } else {
+        printf("✅ Segmento %d descomprimido: %lu bytes desde offset %lu\n",
+               task->segment_id, (unsigned long)task->length, (unsigned long)task->point->out);
+    }
+    pthread_mutex_unlock(task->output_mutex);
+
+cleanup:
+    if (input_fp) fclose(input_fp);
+    if (output_buffer) free(output_buffer);
+    return NULL;
+}
+
+// Leer el trailer gzip (CRC-32 e ISIZE, little-endian) de los últimos 8 bytes
+static int read_gzip_trailer(const char *gz_file, uint32_t *crc, uint32_t *isize) {
+    unsigned char trailer[8];
+    FILE *fp = fopen(gz_file, "rb");
+    if (!fp) return -1;
+    int ok = fseeko(fp, -8, SEEK_END) == 0 && fread(trailer, 1, sizeof(trailer), fp) == sizeof(trailer);
+    fclose(fp);
+    if (!ok) return -1;
+    *crc = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | ((uint32_t)trailer[3] << 24);
+    *isize = trailer[4] | (trailer[5] << 8) | (trailer[6] << 16) | ((uint32_t)trailer[7] << 24);
+    return 0;
+}
+
+// Construir (o reconstruir) el índice de un .gz y guardarlo junto al archivo
+int gz_build_index_file(const char *gz_file) {
+    char index_file[4096];
+    gz_index_t index;
+
+    if (!is_gzip_file(gz_file)) {
+        fprintf(stderr, "Error: '%s' no es un archivo gzip\n", gz_file);
+        return -1;
+    }
+    if (gz_index_path(gz_file, index_file, sizeof(index_file)) != 0) return -1;
+
+    printf("📇 Construyendo índice de puntos de acceso para %s...\n", gz_file);
+    if (gz_index_build(gz_file, GZ_INDEX_SPAN, &index) != 0) return -1;
+
+    int result = gz_index_save(&index, index_file);
+    if (result == 0) {
+        printf("✅ Índice guardado en %s\n", index_file);
+        printf("📊 Tamaño original: %lu bytes\n", (unsigned long)index.original_size);
+        printf("📍 Puntos de acceso: %u (cada ~%u bytes)\n", index.num_points, index.span);
+    } else {
+        fprintf(stderr, "Error: No se pudo guardar el índice en %s\n", index_file);
+    }
+    gz_index_free(&index);
+    return result;
+}
+
+// Descompresión paralela de un .gz estándar usando los puntos de acceso del índice
+int gz_decompress_file(const char *input_file, const char *output_file, int threads) {
+    FILE *output_fp = NULL;
+    gz_index_t index;
+    gz_segment_task_t *tasks = NULL;
+    pthread_t *thread_ids = NULL;
+    pthread_mutex_t output_mutex = PTHREAD_MUTEX_INITIALIZER;
+    uLong crc = crc32(0L, Z_NULL, 0);   // CRC-32 de todo el archivo, combinado segmento a segmento
+    uint32_t expected_crc, expected_isize;
+    int error_flag = 0;
+    int result = 0;
+
+    printf("🔄 Iniciando descompresión paralela de archivo gzip...\n");
+    printf("📦 Archivo comprimido: %s\n", input_file);
+    printf("📁 Archivo salida: %s\n", output_file);
+
+    if (obtain_index(input_file, &index) != 0) {
+        return -1;
+    }
+
+    printf("📊 Archivo original: %lu bytes\n", (unsigned long)index.original_size);
+    printf("🧩 Segmentos: %u\n", index.num_points);
+    printf("🧵 Hilos: %d\n", threads);
+
+    tasks = calloc(threads, sizeof(gz_segment_task_t));
+    thread_ids = calloc(threads, sizeof(pthread_t));
+    output_fp = fopen(output_file, "wb");
+    if (!tasks || !thread_ids || !output_fp) {
+        fprintf(stderr, "Error: No se pudo crear el archivo de salida o allocar memoria\n");
+        result = -1;
+        goto cleanup;
+    }
+
+    // Pre-allocar el archivo de salida al tamaño completo
+    if (ftruncate(fileno(output_fp), index.original_size) != 0) {
+        fprintf(stderr, "Error: No se pudo pre-allocar el archivo de salida\n");
+        result = -1;
+        goto cleanup;
+    }
+
+    printf("\n🚀 Iniciando descompresión paralela...\n");
+
+    // Procesar segmentos con hilos
+    uint32_t segments_processed = 0;
+
+    while (segments_processed < index.num_points && !error_flag) {
+        int active_threads = 0;
+
+        for (int t = 0; t < threads && segments_processed + t < index.num_points; t++) {
+            uint32_t segment_id = segments_processed + t;
+            uint64_t end = (segment_id + 1 < index.num_points) ? index.points[segment_id + 1].out : index.original_size;
+
+            tasks[t].thread_id = t;
+            tasks[t].segment_id = segment_id;
+            tasks[t].gz_file = input_file;
+            tasks[t].point = &index.points[segment_id];
+            tasks[t].length = end - index.points[segment_id].out;
+            tasks[t].output_fp = output_fp;
+            tasks[t].output_mutex = &output_mutex;
+            tasks[t].error_flag = &error_flag;
+
+            if (pthread_create(&thread_ids[t], NULL, gz_segment_thread, &tasks[t]) != 0) {
+                fprintf(stderr, "Error: No se pudo crear el hilo %d\n", t);
+                error_flag = 1;
+                break;
+            }
+            active_threads++;
+        }
+
+        // Esperar que terminen todos los hilos
+        for (int t = 0; t < active_threads; t++) {
+            pthread_join(thread_ids[t], NULL);
+        }
+
+        // Las tandas terminan en orden, así que los CRC se combinan en orden de archivo
+        for (int t = 0; t < active_threads && !error_flag; t++) {
+            crc = crc32_combine(crc, tasks[t].crc, (z_off_t)tasks[t].length);
+        }
+
+        segments_processed += active_threads;
+    }
+
+    if (error_flag) {
+        fprintf(stderr, "❌ Error durante la descompresión\n");
+        result = -1;
+        goto cleanup;
+    }
+
+    // Verificar el trailer gzip: CRC-32 e ISIZE (tamaño original módulo 2^32)
+    if (read_gzip_trailer(input_file, &expected_crc, &expected_isize) != 0) {
+        fprintf(stderr, "Error: No se pudo leer el trailer gzip de %s\n", input_file);
+        result = -1;
+        goto cleanup;
+    }
+    if ((uint32_t)crc != expected_crc || (uint32_t)(index.original_size & 0xffffffff) != expected_isize) {
+        fprintf(stderr, "Error: El CRC-32 o el tamaño no coinciden con el trailer gzip (archivo corrupto)\n");
+        result = -1;
+        goto cleanup;
+    }
+
+    printf("\n✅ Descompresión completada exitosamente!\n");
+    printf("📦 Archivo comprimido: %s\n", input_file);
+    printf("📁 Archivo recuperado: %s (%lu bytes)\n", output_file, (unsigned long)index.original_size);
+
+cleanup:
+    if (output_fp) fclose(output_fp);
+    if (tasks) free(tasks);
+    if (thread_ids) free(thread_ids);
+    gz_index_free(&index);
+    pthread_mutex_destroy(&output_mutex);
+
+    return result;
+}
+
+// Lectura aleatoria: extraer [offset, offset + length) del .gz sin inflar desde el inicio
+// (el CRC-32 del trailer cubre el archivo completo, así que el rango extraído no se verifica)
+int gz_extract_range(const char *gz_file, const char *output_file, uint64_t offset, uint64_t length) {
+    FILE *input_fp = NULL, *output_fp = NULL;
+    gz_index_t index;
+    int result = 0;
+
+    if (obtain_index(gz_file, &index) != 0) {
+        return -1;
+    }
+
+    if (offset >= index.original_size) {
+        fprintf(stderr, "Error: El offset %lu está fuera del archivo (%lu bytes)\n",
+                (unsigned long)offset, (unsigned long)index.original_size);
+        result = -1;
+        goto cleanup;
+    }
+    if (length == 0 || length > index.original_size - offset) {
+        length = index.original_size - offset;
+    }
+
+    // Último punto de acceso con out <= offset (búsqueda binaria)
+    uint32_t lo = 0, hi = index.num_points;
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (index.points[mid].out <= offset) lo = mid;
+        else hi = mid;
+    }
+    const gz_access_point_t *point = &index.points[lo];
+
+    printf("🎯 Extrayendo %lu bytes desde el offset %lu (punto de acceso %u en offset %lu)\n",
+           (unsigned long)length, (unsigned long)offset, lo, (unsigned long)point->out);
+
+    input_fp = fopen(gz_file, "rb");
+    output_fp = fopen(output_file, "wb");
+    if (!input_fp || !output_fp) {
+        fprintf(stderr, "Error: No se pudieron abrir los archivos\n");
+        result = -1;
+        goto cleanup;
+    }
+
+    if (inflate_from_point(input_fp, point, offset - point->out, NULL, output_fp, length) != (int64_t)length) {
+        fprintf(stderr, "❌ Error extrayendo el rango solicitado\n");
+        result = -1;
+        goto cleanup;
+    }
+
+    printf("\n✅ Rango extraído exitosamente en %s\n", output_file);
+
+cleanup:
+    if (input_fp) fclose(input_fp);
+    if (output_fp && fclose(output_fp) != 0) result = -1;
+    gz_index_free(&index);
+    return result;
+}
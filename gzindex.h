@@ -0,0 +1,64 @@
+#ifndef GZINDEX_H
+#define GZINDEX_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define GZ_INDEX_MAGIC 0x58444E495A50ULL  // "PZINDX" in hex
+#define GZ_INDEX_SUFFIX ".pzi"            // Sufijo del índice junto al .gz
+#define GZ_INDEX_SPAN 4194304             // 4MB sin comprimir entre puntos de acceso
+#define GZ_WINDOW_SIZE 32768              // Ventana de deflate (32KB)
+
+// Punto de acceso: estado mínimo para reanudar inflate en medio del stream
+typedef struct {
+    uint64_t out;                 // Offset en los datos descomprimidos
+    uint64_t in;                  // Offset en el .gz del primer byte completo del bloque
+    uint32_t bits;                // Bits (0-7) del byte anterior que pertenecen al bloque
+    uint32_t window_size;         // Bytes válidos de ventana (<= 32KB)
+    unsigned char *window;        // Últimos bytes descomprimidos antes de 'out'
+} gz_access_point_t;
+
+// Índice completo de un archivo .gz
+typedef struct {
+    uint32_t num_points;
+    uint32_t span;
+    uint64_t gz_size;             // Tamaño del .gz indexado (para detectar índices obsoletos)
+    uint64_t gz_mtime;            // Fecha de modificación del .gz indexado
+    uint64_t original_size;       // Tamaño total descomprimido
+    gz_access_point_t *points;
+} gz_index_t;
+
+// Header del archivo de índice en disco
+typedef struct {
+    uint64_t magic;
+    uint32_t num_points;
+    uint32_t span;
+    uint64_t gz_size;
+    uint64_t gz_mtime;
+    uint64_t original_size;
+} gz_index_header_t;
+
+// Registro de un punto en disco (seguido de la ventana comprimida con zlib)
+typedef struct {
+    uint64_t out;
+    uint64_t in;
+    uint32_t bits;
+    uint32_t window_size;
+    uint32_t stored_size;         // Bytes de la ventana comprimida que siguen al registro
+    uint32_t reserved;
+} gz_point_record_t;
+
+// Funciones principales
+int is_gzip_file(const char *filename);
+int gz_build_index_file(const char *gz_file);
+int gz_decompress_file(const char *input_file, const char *output_file, int threads);
+int gz_extract_range(const char *gz_file, const char *output_file, uint64_t offset, uint64_t length);
+
+// Funciones auxiliares
+int gz_index_build(const char *gz_file, uint32_t span, gz_index_t *index);
+int gz_index_save(const gz_index_t *index, const char *index_file);
+int gz_index_load(const char *index_file, gz_index_t *index);
+int gz_index_path(const char *gz_file, char *buf, size_t len);
+void gz_index_free(gz_index_t *index);
+
+#endif
@@ -5,6 +5,9 @@
 #include <unistd.h>
 #include "compressor.h"
 #include "utils.h"
+#include "daemon.h"
+#include "gzindex.h"
+#include "search.h"
 
 void print_usage(const char *program_name) {
     printf("🗂️ ParZip - Compresor de Archivos Paralelo\n");
@@ -12,19 +15,65 @@ void print_usage(const char *program_name) {
     printf("COMPRESIÓN:\n");
     printf("  %s -c [-t threads] [-b block_size] [-l level] <archivo_entrada> <archivo_salida.pz>\n\n", program_name);
     printf("DESCOMPRESIÓN:\n");
-    printf("  %s -d [-t threads] <archivo_comprimido.pz> <archivo_salida>\n\n", program_name);
+    printf("  %s -d [-t threads] [--verify] <archivo_comprimido.pz> <archivo_salida>\n\n", program_name);
+    printf("GZIP ESTÁNDAR (.gz):\n");
+    printf("  %s --gz-index <archivo.gz>\n", program_name);
+    printf("  %s -d [-t threads] [--range offset:longitud] <archivo.gz> <archivo_salida>\n\n", program_name);
+    printf("COMPRESIÓN POR FRAGMENTOS:\n");
+    printf("  %s -c --shard i/N [-t threads] [-b block_size] [-l level] <archivo_entrada> <fragmento_i.pz>\n", program_name);
+    printf("  %s --merge <archivo_salida.pz> <fragmento_1.pz> ... <fragmento_N.pz>\n\n", program_name);
+    printf("BÚSQUEDA:\n");
+    printf("  %s --grep PATRÓN [-t threads] <archivo_comprimido.pz>\n\n", program_name);
+    printf("DAEMON:\n");
+    printf("  %s --serve [-t threads] [--socket ruta]\n\n", program_name);
     printf("OPCIONES:\n");
     printf("  -c, --compress          Comprimir archivo\n");
     printf("  -d, --decompress        Descomprimir archivo\n");
     printf("  -t, --threads N         Número de hilos (por defecto: CPUs disponibles)\n");
     printf("  -b, --block-size N      Tamaño de bloque en bytes (por defecto: 64KB)\n");
     printf("  -l, --level N           Nivel de compresión 0-9 (por defecto: 6)\n");
+    printf("      --gz-index          Construir índice de puntos de acceso (<archivo.gz>%s)\n", GZ_INDEX_SUFFIX);
+    printf("      --range OFF:LEN     Extraer solo un rango de un .gz usando el índice (sin verificar CRC)\n");
+    printf("      --target-rate MB/s  Ajustar el nivel por bloque para sostener ese throughput\n");
+    printf("      --base ARCHIVO.pz   Reutilizar los bloques sin cambios de un .pz anterior\n");
+    printf("      --direct            E/S directa (O_DIRECT), sin pasar por la caché de páginas\n");
+    printf("      --verify            Comprobar cada bloque contra su SHA-256 al descomprimir\n");
+    printf("      --shard i/N         Comprimir solo el fragmento i (1..N) del archivo\n");
+    printf("      --merge             Unir fragmentos en un .pz completo sin recomprimir\n");
+    printf("      --grep PATRÓN       Buscar un texto en el .pz sin descomprimirlo a disco\n");
+    printf("      --serve             Iniciar daemon residente con pool de hilos\n");
+    printf("      --socket RUTA       Socket del daemon (por defecto: $%s o $XDG_RUNTIME_DIR/parzip.sock)\n", DAEMON_SOCKET_ENV);
+    printf("      --no-daemon         No usar el daemon aunque esté activo\n");
     printf("  -h, --help              Mostrar esta ayuda\n");
     printf("  -v, --version           Mostrar versión\n\n");
     printf("EJEMPLOS:\n");
     printf("  %s -c archivo.txt archivo.pz\n", program_name);
     printf("  %s -c -t 8 -b 32768 -l 9 video.mp4 video.pz\n", program_name);
     printf("  %s -d archivo.pz archivo_recuperado.txt\n", program_name);
+    printf("  %s -c --target-rate 200 logs.tar logs.pz\n", program_name);
+    printf("  %s -c --base backup_lunes.pz disco.img backup_martes.pz\n", program_name);
+    printf("  %s -d -t 8 datos.gz datos.txt\n", program_name);
+    printf("  %s --grep \"ERROR 503\" logs.pz\n", program_name);
+    printf("  %s -c --shard 2/4 export.csv export.2.pz\n", program_name);
+    printf("  %s --merge export.pz export.1.pz export.2.pz export.3.pz export.4.pz\n", program_name);
+    printf("  %s --serve -t 8 &\n", program_name);
+}
+
+// Preguntar antes de sobrescribir un archivo existente (1 = continuar, 0 = cancelar, -1 = error)
+static int confirm_overwrite(const char *output_file) {
+    if (!file_exists(output_file)) return 1;
+    
+    printf("⚠️  El archivo de salida '%s' ya existe. ¿Sobrescribir? (s/N): ", output_file);
+    char response;
+    if (scanf(" %c", &response) != 1) {
+        fprintf(stderr, "Error leyendo respuesta\n");
+        return -1;
+    }
+    if (response != 's' && response != 'S') {
+        printf("Operación cancelada.\n");
+        return 0;
+    }
+    return 1;
 }
 
 void print_version() {
@@ -57,6 +106,24 @@ int main(int argc, char *argv[]) {
     int compression_level = Z_DEFAULT_COMPRESSION;
     char *input_file = NULL;
     char *output_file = NULL;
+    int serve_mode = 0;
+    int use_daemon = 1;
+    char socket_path[108];
+    int gz_index_mode = 0;
+    int range_mode = 0;
+    uint64_t range_offset = 0, range_length = 0;
+    int direct_io = 0;
+    double target_rate = 0;
+    char *base_file = NULL;
+    char *grep_pattern = NULL;
+    int merge_mode = 0;
+    int shard_index = 0, shard_count = 0;
+    int verify = 0;
+    
+    if (daemon_socket_path(socket_path, sizeof(socket_path)) != 0) {
+        use_daemon = 0;
+        socket_path[0] = '\0';
+    }
     
     // Definir opciones largas
     static struct option long_options[] = {
@@ -67,6 +134,18 @@ int main(int argc, char *argv[]) {
         {"level",        required_argument, 0, 'l'},
         {"help",         no_argument,       0, 'h'},
         {"version",      no_argument,       0, 'v'},
+        {"serve",        no_argument,       0, 'S'},
+        {"socket",       required_argument, 0, 'U'},
+        {"no-daemon",    no_argument,       0, 'N'},
+        {"gz-index",     no_argument,       0, 'G'},
+        {"range",        required_argument, 0, 'R'},
+        {"direct",       no_argument,       0, 'D'},
+        {"target-rate",  required_argument, 0, 'T'},
+        {"base",         required_argument, 0, 'B'},
+        {"grep",         required_argument, 0, 'P'},
+        {"shard",        required_argument, 0, 'F'},
+        {"merge",        no_argument,       0, 'M'},
+        {"verify",       no_argument,       0, 'V'},
         {0, 0, 0, 0}
     };
     
@@ -107,6 +186,74 @@ int main(int argc, char *argv[]) {
                     return 1;
                 }
                 break;
+            case 'S':
+                serve_mode = 1;
+                break;
+            case 'U':
+                if (strlen(optarg) >= sizeof(socket_path)) {
+                    fprintf(stderr, "Error: Ruta de socket demasiado larga\n");
+                    return 1;
+                }
+                strcpy(socket_path, optarg);
+                use_daemon = 1;
+                break;
+            case 'N':
+                use_daemon = 0;
+                break;
+            case 'T':
+                target_rate = atof(optarg);
+                if (target_rate <= 0) {
+                    fprintf(stderr, "Error: --target-rate debe ser un throughput positivo en MB/s\n");
+                    return 1;
+                }
+                break;
+            case 'D':
+                direct_io = 1;
+                break;
+            case 'B':
+                base_file = optarg;
+                break;
+            case 'P':
+                grep_pattern = optarg;
+                break;
+            case 'F': {
+                char *end;
+                shard_index = (int)strtol(optarg, &end, 10);
+                if (*end != '/' || end == optarg) {
+                    fprintf(stderr, "Error: --shard espera el formato i/N\n");
+                    return 1;
+                }
+                shard_count = (int)strtol(end + 1, &end, 10);
+                if (*end != '\0' || shard_count < 1 || shard_index < 1 || shard_index > shard_count) {
+                    fprintf(stderr, "Error: --shard espera i/N con 1 <= i <= N\n");
+                    return 1;
+                }
+                break;
+            }
+            case 'M':
+                merge_mode = 1;
+                break;
+            case 'V':
+                verify = 1;
+                break;
+            case 'G':
+                gz_index_mode = 1;
+                break;
+            case 'R': {
+                char *end;
+                range_offset = strtoull(optarg, &end, 10);
+                if (*end != ':' || end == optarg) {
+                    fprintf(stderr, "Error: --range espera el formato offset:longitud\n");
+                    return 1;
+                }
+                range_length = strtoull(end + 1, &end, 10);
+                if (*end != '\0') {
+                    fprintf(stderr, "Error: --range espera el formato offset:longitud\n");
+                    return 1;
+                }
+                range_mode = 1;
+                break;
+            }
             case 'h':
                 print_usage(argv[0]);
                 return 0;
@@ -121,6 +268,63 @@ int main(int argc, char *argv[]) {
         }
     }
     
+    // Modo daemon: no requiere archivos
+    if (serve_mode) {
+        if (compress_mode || decompress_mode || optind != argc) {
+            fprintf(stderr, "Error: --serve no acepta -c, -d ni archivos\n");
+            return 1;
+        }
+        print_banner();
+        return run_daemon(socket_path, threads) == 0 ? 0 : 1;
+    }
+    
+    // Indexar un .gz: solo requiere el archivo de entrada
+    if (gz_index_mode) {
+        if (compress_mode || decompress_mode || optind + 1 != argc) {
+            fprintf(stderr, "Error: --gz-index requiere únicamente el archivo .gz\n");
+            return 1;
+        }
+        if (!file_exists(argv[optind])) {
+            fprintf(stderr, "Error: El archivo de entrada '%s' no existe\n", argv[optind]);
+            return 1;
+        }
+        return gz_build_index_file(argv[optind]) == 0 ? 0 : 1;
+    }
+    
+    // Unir fragmentos: la salida va primero, seguida de los fragmentos en cualquier orden
+    if (merge_mode) {
+        if (compress_mode || decompress_mode || optind + 2 > argc) {
+            fprintf(stderr, "Error: --merge requiere el archivo de salida y al menos un fragmento\n");
+            return 1;
+        }
+        for (int i = optind + 1; i < argc; i++) {
+            if (!file_exists(argv[i])) {
+                fprintf(stderr, "Error: El fragmento '%s' no existe\n", argv[i]);
+                return 1;
+            }
+        }
+        int overwrite = confirm_overwrite(argv[optind]);
+        if (overwrite <= 0) {
+            return overwrite < 0 ? 1 : 0;
+        }
+        return merge_parzip_files(argv[optind], &argv[optind + 1], argc - optind - 1) == 0 ? 0 : 1;
+    }
+    
+    // Buscar dentro de un .pz: solo requiere el archivo comprimido y no escribe nada a disco
+    if (grep_pattern) {
+        if (compress_mode || decompress_mode || optind + 1 != argc) {
+            fprintf(stderr, "Error: --grep requiere únicamente el archivo .pz\n");
+            return 1;
+        }
+        if (!file_exists(argv[optind])) {
+            fprintf(stderr, "Error: El archivo de entrada '%s' no existe\n", argv[optind]);
+            return 2;
+        }
+        // Códigos de salida como grep: 0 con coincidencias, 1 sin coincidencias, 2 si hubo error
+        int64_t matches = grep_archive(argv[optind], grep_pattern, threads);
+        return matches < 0 ? 2 : (matches > 0 ? 0 : 1);
+    }
+    
     // Verificar que se especificó modo de operación
     if (!compress_mode && !decompress_mode) {
         fprintf(stderr, "Error: Debe especificar -c (comprimir) o -d (descomprimir)\n");
@@ -149,28 +353,71 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
-    // Verificar que el archivo de salida no existe (para evitar sobrescribir)
-    if (file_exists(output_file)) {
-        printf("⚠️  El archivo de salida '%s' ya existe. ¿Sobrescribir? (s/N): ", output_file);
-        char response;
-        if (scanf(" %c", &response) != 1) {
-            fprintf(stderr, "Error leyendo respuesta\n");
+    if (shard_count > 0 && !compress_mode) {
+        fprintf(stderr, "Error: --shard solo está disponible al comprimir\n");
+        return 1;
+    }
+    if (verify && !decompress_mode) {
+        fprintf(stderr, "Error: --verify solo está disponible al descomprimir\n");
+        return 1;
+    }
+    
+    // El archivo base solo tiene sentido al comprimir
+    if (base_file) {
+        if (!compress_mode) {
+            fprintf(stderr, "Error: --base solo está disponible al comprimir\n");
             return 1;
         }
-        if (response != 's' && response != 'S') {
-            printf("Operación cancelada.\n");
-            return 0;
+        if (!file_exists(base_file)) {
+            fprintf(stderr, "Error: El archivo base '%s' no existe\n", base_file);
+            return 1;
         }
     }
     
+    // Los .gz estándar se descomprimen con el índice de puntos de acceso
+    int gzip_input = decompress_mode && is_gzip_file(input_file);
+    if (range_mode && !gzip_input) {
+        fprintf(stderr, "Error: --range solo está disponible al descomprimir archivos .gz\n");
+        return 1;
+    }
+    
+    // Verificar que el archivo de salida no existe (para evitar sobrescribir)
+    int overwrite = confirm_overwrite(output_file);
+    if (overwrite <= 0) {
+        return overwrite < 0 ? 1 : 0;
+    }
+    
     print_banner();
     
     // Ejecutar operación
-    int result;
-    if (compress_mode) {
-        result = compress_file(input_file, output_file, threads, block_size, compression_level);
-    } else {
-        result = decompress_file(input_file, output_file, threads);
+    // Usar el daemon si hay uno escuchando; si no, procesar localmente
+    int result = DAEMON_UNAVAILABLE;
+    if (gzip_input) {
+        result = range_mode ? gz_extract_range(input_file, output_file, range_offset, range_length)
+                            : gz_decompress_file(input_file, output_file, threads);
+    } else if (use_daemon && !direct_io && target_rate == 0 && !base_file && shard_count == 0 && !verify) {
+        // El daemon solo atiende trabajos con las opciones básicas
+        result = daemon_submit(socket_path, compress_mode ? DAEMON_JOB_COMPRESS : DAEMON_JOB_DECOMPRESS,
+                               input_file, output_file, block_size, compression_level);
+    }
+    if (result == DAEMON_UNAVAILABLE) {
+        parzip_options_t opts;
+        parzip_default_options(&opts);
+        opts.threads = threads;
+        opts.block_size = block_size;
+        opts.compression_level = compression_level;
+        opts.direct_io = direct_io;
+        opts.target_rate = target_rate;
+        opts.base_file = base_file;
+        opts.shard_index = shard_index;
+        opts.shard_count = shard_count;
+        opts.verify = verify;
+        
+        if (compress_mode) {
+            result = compress_file_ex(input_file, output_file, &opts);
+        } else {
+            result = decompress_file_ex(input_file, output_file, &opts);
+        }
     }
     
     if (result == 0) {
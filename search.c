@@ -0,0 +1,287 @@
+#define _GNU_SOURCE
+#include "search.h"
+#include "compressor.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <zlib.h>
+
+// Resultados formateados de un bloque ("offset:contexto" por línea)
+typedef struct {
+    char *text;
+    size_t length;
+    size_t capacity;
+    uint64_t matches;
+} grep_results_t;
+
+// Datos de un hilo que descomprime un bloque y lo busca en memoria
+typedef struct {
+    int thread_id;
+    uint32_t block_id;
+    int input_fd;
+    const block_info_t *block_info;
+    uint64_t block_offset;        // Offset del bloque en el archivo original
+    const char *pattern;
+    size_t pattern_length;
+    unsigned char *buffer;        // Bloque descomprimido (se conserva hasta revisar la frontera)
+    grep_results_t results;
+    int *error_flag;
+} grep_task_t;
+
+static int results_append(grep_results_t *r, const char *data, size_t len) {
+    if (r->length + len > r->capacity) {
+        size_t capacity = r->capacity ? r->capacity * 2 : 4096;
+        while (capacity < r->length + len) capacity *= 2;
+        char *grown = realloc(r->text, capacity);
+        if (!grown) return -1;
+        r->text = grown;
+        r->capacity = capacity;
+    }
+    memcpy(r->text + r->length, data, len);
+    r->length += len;
+    return 0;
+}
+
+// Registrar una coincidencia con la línea que la contiene (acotada a GREP_CONTEXT bytes por lado)
+static int record_match(grep_results_t *r, const unsigned char *buf, size_t len, size_t pos,
+                        size_t pattern_length, uint64_t file_offset) {
+    size_t start = pos, end = pos + pattern_length;
+    while (start > 0 && pos - start < GREP_CONTEXT && buf[start - 1] != '\n') start--;
+    while (end < len && end - pos - pattern_length < GREP_CONTEXT && buf[end] != '\n') end++;
+
+    char line[32 + 2 * GREP_CONTEXT + 1];
+    int n = snprintf(line, 32, "%lu:", (unsigned long)file_offset);
+    for (size_t i = start; i < end && (size_t)n < sizeof(line) - 1; i++) {
+        unsigned char ch = buf[i];
+        line[n++] = (ch >= 0x20 && ch < 0x7f) || ch == '\t' || ch >= 0x80 ? (char)ch : '.';
+    }
+    line[n++] = '\n';
+
+    if (results_append(r, line, n) != 0) return -1;
+    r->matches++;
+    return 0;
+}
+
+// Buscar todas las apariciones del patrón que empiezan en [from, to) de un buffer.
+// Se reportan también las que se solapan ("aa" en "aaaa" da 3 líneas): así cada
+// bloque y cada frontera se buscan de forma independiente, sin depender del anterior.
+static int search_buffer(grep_results_t *r, const unsigned char *buf, size_t len, size_t from, size_t to,
+                         const char *pattern, size_t pattern_length, uint64_t base_offset) {
+    // memmem de glibc usa comparaciones vectorizadas para encontrar candidatos
+    size_t pos = from;
+    while (pos < to && pos + pattern_length <= len) {
+        const unsigned char *hit = memmem(buf + pos, len - pos, pattern, pattern_length);
+        if (!hit) break;
+        size_t found = hit - buf;
+        if (found >= to) break;
+        if (record_match(r, buf, len, found, pattern_length, base_offset + found) != 0) return -1;
+        pos = found + 1;
+    }
+    return 0;
+}
+
+// Hilo de búsqueda: descomprime el bloque en memoria y busca dentro de él
+static void* grep_block_thread(void* arg) {
+    grep_task_t *task = (grep_task_t*)arg;
+    const block_info_t *info = task->block_info;
+    unsigned char *compressed = NULL;
+
+    // Los bloques de ceros no tienen datos: el buffer ya está en ceros (calloc)
+    task->buffer = calloc(info->original_size ? info->original_size : 1, 1);
+    if (!task->buffer) {
+        fprintf(stderr, "Error: No se pudo allocar memoria en hilo %d\n", task->thread_id);
+        *task->error_flag = 1;
+        return NULL;
+    }
+
+    if (!(info->flags & BLOCK_FLAG_ZERO)) {
+        compressed = malloc(info->compressed_size ? info->compressed_size : 1);
+        if (!compressed) {
+            fprintf(stderr, "Error: No se pudo allocar memoria en hilo %d\n", task->thread_id);
+            *task->error_flag = 1;
+            return NULL;
+        }
+        if (pread_full(task->input_fd, compressed, info->compressed_size, info->offset) != (ssize_t)info->compressed_size) {
+            fprintf(stderr, "Error: No se pudo leer el bloque comprimido %u\n", task->block_id);
+            *task->error_flag = 1;
+            goto cleanup;
+        }
+
+        uLongf decompressed_size = info->original_size;
+        int rc = uncompress(task->buffer, &decompressed_size, compressed, info->compressed_size);
+        if (rc != Z_OK || decompressed_size != info->original_size) {
+            fprintf(stderr, "Error: Fallo en descompresión del bloque %u (código: %d)\n", task->block_id, rc);
+            *task->error_flag = 1;
+            goto cleanup;
+        }
+    }
+
+    if (search_buffer(&task->results, task->buffer, info->original_size, 0, info->original_size,
+                      task->pattern, task->pattern_length, task->block_offset) != 0) {
+        fprintf(stderr, "Error: No se pudo allocar memoria en hilo %d\n", task->thread_id);
+        *task->error_flag = 1;
+    }
+
+cleanup:
+    free(compressed);
+    return NULL;
+}
+
+// Buscar un patrón literal dentro de un .pz sin escribir nada a disco.
+// Devuelve el número de coincidencias o -1 si hubo error.
+int64_t grep_archive(const char *archive_file, const char *pattern, int threads) {
+    FILE *input_fp = NULL;
+    int input_fd = -1;
+    parzip_header_t header;
+    block_info_t *block_infos = NULL;
+    grep_task_t *tasks = NULL;
+    pthread_t *thread_ids = NULL;
+    unsigned char *seam = NULL;     // Cola del bloque anterior + cabeza del actual
+    size_t seam_tail = 0;           // Bytes válidos de la cola del bloque anterior
+    uint64_t seam_offset = 0;       // Offset en el original del primer byte de la cola
+    size_t pattern_length = strlen(pattern);
+    size_t seam_span = GREP_CONTEXT + pattern_length;
+    int error_flag = 0;
+    int64_t matches = 0;
+    struct timespec start;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    input_fp = fopen(archive_file, "rb");
+    if (!input_fp) {
+        fprintf(stderr, "Error: No se pudo abrir el archivo comprimido: %s\n", archive_file);
+        return -1;
+    }
+
+    if (read_parzip_header(input_fp, &header) != 0 || !is_parzip_magic(header.magic)) {
+        fprintf(stderr, "Error: El archivo no es un archivo .pz válido\n");
+        matches = -1;
+        goto cleanup;
+    }
+    if (parzip_flags(&header) & PARZIP_FLAG_PARTIAL) {
+        fprintf(stderr, "Error: El archivo es un fragmento (--shard); únalo primero con --merge\n");
+        matches = -1;
+        goto cleanup;
+    }
+    if (pattern_length == 0 || pattern_length > header.block_size) {
+        fprintf(stderr, "Error: El patrón debe tener entre 1 y %u bytes (tamaño de bloque)\n", header.block_size);
+        matches = -1;
+        goto cleanup;
+    }
+
+    block_infos = calloc(header.num_blocks ? header.num_blocks : 1, sizeof(block_info_t));
+    tasks = calloc(threads, sizeof(grep_task_t));
+    thread_ids = calloc(threads, sizeof(pthread_t));
+    seam = malloc(2 * seam_span);
+    input_fd = open(archive_file, O_RDONLY | O_CLOEXEC);
+
+    if (!block_infos || !tasks || !thread_ids || !seam || input_fd < 0) {
+        fprintf(stderr, "Error: No se pudo allocar memoria o abrir el archivo\n");
+        matches = -1;
+        goto cleanup;
+    }
+    if (read_parzip_tables(input_fp, &header, block_infos, NULL) != 0) {
+        fprintf(stderr, "Error: No se pudo leer la tabla de bloques\n");
+        matches = -1;
+        goto cleanup;
+    }
+
+    fprintf(stderr, "🔎 Buscando \"%s\" en %s (%u bloques, %d hilos)\n", pattern, archive_file, header.num_blocks, threads);
+
+    // Procesar bloques por tandas; los resultados se imprimen en orden de archivo al terminar cada tanda
+    uint32_t blocks_processed = 0;
+
+    while (blocks_processed < header.num_blocks && !error_flag) {
+        int active_threads = 0;
+
+        for (int t = 0; t < threads && blocks_processed + t < header.num_blocks; t++) {
+            uint32_t block_id = blocks_processed + t;
+
+            memset(&tasks[t], 0, sizeof(grep_task_t));
+            tasks[t].thread_id = t;
+            tasks[t].block_id = block_id;
+            tasks[t].input_fd = input_fd;
+            tasks[t].block_info = &block_infos[block_id];
+            tasks[t].block_offset = (uint64_t)block_id * header.block_size;
+            tasks[t].pattern = pattern;
+            tasks[t].pattern_length = pattern_length;
+            tasks[t].error_flag = &error_flag;
+
+            if (pthread_create(&thread_ids[t], NULL, grep_block_thread, &tasks[t]) != 0) {
+                fprintf(stderr, "Error: No se pudo crear el hilo %d\n", t);
+                error_flag = 1;
+                break;
+            }
+            active_threads++;
+        }
+
+        // Esperar que terminen todos los hilos
+        for (int t = 0; t < active_threads; t++) {
+            pthread_join(thread_ids[t], NULL);
+        }
+
+        for (int t = 0; t < active_threads && !error_flag; t++) {
+            grep_task_t *task = &tasks[t];
+            size_t size = task->block_info->original_size;
+
+            // Coincidencias que cruzan la frontera con el bloque anterior: empiezan en su cola
+            if (seam_tail > 0) {
+                grep_results_t seam_results;
+                memset(&seam_results, 0, sizeof(seam_results));
+                size_t head = size < seam_span ? size : seam_span;
+                size_t from = seam_tail >= pattern_length ? seam_tail - pattern_length + 1 : 0;
+                memcpy(seam + seam_tail, task->buffer, head);
+                if (search_buffer(&seam_results, seam, seam_tail + head, from, seam_tail,
+                                  pattern, pattern_length, seam_offset) != 0) {
+                    error_flag = 1;
+                }
+                fwrite(seam_results.text, 1, seam_results.length, stdout);
+                matches += seam_results.matches;
+                free(seam_results.text);
+            }
+
+            // Coincidencias completamente dentro del bloque
+            fwrite(task->results.text, 1, task->results.length, stdout);
+            matches += task->results.matches;
+
+            // Guardar la cola de este bloque para revisar la frontera con el siguiente
+            seam_tail = size < seam_span ? size : seam_span;
+            seam_offset = task->block_offset + size - seam_tail;
+            memcpy(seam, task->buffer + size - seam_tail, seam_tail);
+        }
+
+        for (int t = 0; t < active_threads; t++) {
+            free(tasks[t].buffer);
+            free(tasks[t].results.text);
+        }
+
+        blocks_processed += active_threads;
+    }
+
+    if (error_flag) {
+        fprintf(stderr, "❌ Error durante la búsqueda\n");
+        matches = -1;
+        goto cleanup;
+    }
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    fflush(stdout);
+    fprintf(stderr, "✅ %ld coincidencias en %lu bytes (%.2fs)\n", (long)matches, (unsigned long)header.original_size,
+            (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+
+cleanup:
+    if (input_fp) fclose(input_fp);
+    if (input_fd >= 0) close(input_fd);
+    if (block_infos) free(block_infos);
+    if (tasks) free(tasks);
+    if (thread_ids) free(thread_ids);
+    if (seam) free(seam);
+
+    return matches;
+}
@@ -0,0 +1,11 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdint.h>
+
+#define GREP_CONTEXT 80   // Bytes de contexto a cada lado de una coincidencia
+
+// Funciones principales
+int64_t grep_archive(const char *archive_file, const char *pattern, int threads);
+
+#endif
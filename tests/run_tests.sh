@@ -0,0 +1,354 @@
+#!/bin/sh
+# Pruebas de integración de ParZip (formato V2 y modos avanzados)
+# Uso: sh tests/run_tests.sh ./parzip   (lo ejecuta `make test`)
+
+PARZIP="$(cd "$(dirname "$1")" && pwd)/$(basename "$1")"
+FIXTURES="$(cd "$(dirname "$0")" && pwd)/fixtures"
+WORK="$(mktemp -d)"
+daemon_pid=""
+trap '[ -n "$daemon_pid" ] && kill "$daemon_pid" 2> /dev/null; rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+FAILED=0
+
+pass() { echo "  ✅ $1"; }
+fail() { echo "  ❌ $1"; FAILED=1; }
+
+# pz: ejecutar parzip siempre en modo local (sin daemon)
+pz() { "$PARZIP" --no-daemon "$@"; }
+
+# expect_ok DESCRIPCIÓN COMANDO...: el comando debe terminar con éxito
+expect_ok() {
+    desc="$1"; shift
+    if "$@" > out.log 2>&1; then pass "$desc"; else fail "$desc"; cat out.log; fi
+}
+
+# expect_error DESCRIPCIÓN TEXTO COMANDO...: debe fallar mostrando TEXTO
+expect_error() {
+    desc="$1"; text="$2"; shift 2
+    if "$@" > out.log 2>&1; then
+        fail "$desc (terminó sin error)"
+    elif grep -q "$text" out.log; then
+        pass "$desc"
+    else
+        fail "$desc (falta \"$text\")"; cat out.log
+    fi
+}
+
+# expect_exit DESCRIPCIÓN CÓDIGO COMANDO...: el comando debe terminar con ese código
+expect_exit() {
+    desc="$1"; code="$2"; shift 2
+    "$@" > out.log 2> /dev/null
+    rc=$?
+    if [ "$rc" -eq "$code" ]; then pass "$desc"; else fail "$desc (código $rc, se esperaba $code)"; fi
+}
+
+# Leer un entero little-endian de N bytes (4 u 8) en un offset del archivo
+read_uint() { od -An -t "u$3" -j "$2" -N "$3" "$1" | tr -d ' '; }
+
+# Offset, tamaño comprimido, flags y nivel del bloque I en la tabla (header de 32 bytes, block_info_t de 24)
+block_offset() { read_uint "$1" $((32 + $2 * 24 + 16)) 8; }
+block_csize() { read_uint "$1" $((32 + $2 * 24 + 8)) 4; }
+block_flags() { read_uint "$1" $((32 + $2 * 24 + 12)) 2; }
+block_level() { read_uint "$1" $((32 + $2 * 24 + 14)) 2; }
+
+echo "🧪 Re-archivado incremental y formato V2 (--base)"
+
+# 8 bloques de 4KB; el segundo archivo solo cambia un byte del bloque 3
+seq 1 20000 | head -c 32768 > base.txt
+cp base.txt changed.txt
+printf 'X' | dd of=changed.txt bs=1 seek=13000 conv=notrunc 2> /dev/null
+
+expect_ok "comprimir la base" pz -c -t 4 -b 4096 base.txt base.pz
+expect_ok "re-archivar con --base" pz -c -t 4 --base base.pz changed.txt changed.pz
+if grep -q "Bloques reutilizados de la base: 7 de 8" out.log; then
+    pass "7 de 8 bloques reutilizados"
+else
+    fail "7 de 8 bloques reutilizados"; grep "reutilizados" out.log
+fi
+expect_ok "descomprimir el re-archivado" pz -d changed.pz changed.out
+expect_ok "re-archivado idéntico al original" cmp changed.txt changed.out
+
+expect_error "--base con un archivo V1 se rechaza" "no tiene hashes" \
+    pz -c --base "$FIXTURES/v1_sample.pz" changed.txt from_v1.pz
+expect_ok "descomprimir un archivo V1" pz -d "$FIXTURES/v1_sample.pz" v1.out
+expect_ok "archivo V1 idéntico al original" cmp "$FIXTURES/v1_sample.txt" v1.out
+expect_ok "descomprimir con --verify" pz -d --verify changed.pz verified.out
+expect_ok "--verify idéntico al original" cmp changed.txt verified.out
+expect_ok "--verify sobre un archivo V1 solo avisa" pz -d --verify "$FIXTURES/v1_sample.pz" v1_verify.out
+if grep -q "no tiene digests" out.log; then pass "aviso de V1 sin digests"; else fail "aviso de V1 sin digests"; fi
+
+# Dos bloques distintos con el mismo tamaño comprimido: copiar el payload del bloque 1
+# sobre el del 0 deja un stream zlib válido, que solo la tabla de digests detecta
+printf '%4096s' '' | tr ' ' 'a' > swap.txt
+printf '%4096s' '' | tr ' ' 'b' >> swap.txt
+pz -c -t 1 -b 4096 swap.txt swap.pz > /dev/null 2>&1
+if [ "$(block_csize swap.pz 0)" = "$(block_csize swap.pz 1)" ]; then
+    dd if=swap.pz of=swap.pz bs=1 skip="$(block_offset swap.pz 1)" seek="$(block_offset swap.pz 0)" \
+       count="$(block_csize swap.pz 1)" conv=notrunc 2> /dev/null
+    expect_error "payload corrupto detectado por --verify" "no coincide con su hash" pz -d --verify swap.pz swap.out
+else
+    fail "preparar el payload corrupto (tamaños comprimidos distintos)"
+fi
+
+echo "🧪 Búsqueda en paralelo (--grep)"
+
+# Bloques de 1KB con el patrón dentro de un bloque y cruzando las fronteras 1024 y 2048
+# (con -t 2 la frontera 2048 queda además entre dos tandas de hilos)
+printf '%3000s' '' | tr ' ' '.' > needle.txt
+for at in 100 1017 2047; do
+    printf 'AGUJA-EN-FRONTERA' | dd of=needle.txt bs=1 seek=$at conv=notrunc 2> /dev/null
+done
+pz -c -b 1024 needle.txt needle.pz > /dev/null 2>&1
+expect_exit "--grep con coincidencias devuelve 0" 0 pz --grep AGUJA-EN-FRONTERA -t 2 needle.pz
+offsets="$(cut -d: -f1 out.log | tr '\n' ' ')"
+if [ "$offsets" = "100 1017 2047 " ]; then
+    pass "offsets dentro del bloque y en las fronteras"
+else
+    fail "offsets dentro del bloque y en las fronteras (obtenido: $offsets)"
+fi
+expect_exit "--grep sin coincidencias devuelve 1" 1 pz --grep NO-ESTA needle.pz
+expect_exit "--grep sobre un archivo inexistente devuelve 2" 2 pz --grep AGUJA no_existe.pz
+expect_exit "--grep sobre un archivo que no es .pz devuelve 2" 2 pz --grep AGUJA needle.txt
+
+# Las apariciones solapadas se reportan todas, también a través de una frontera
+printf '%1022s' '' | tr ' ' '.' > overlap.txt
+printf 'aaaa' >> overlap.txt
+pz -c -b 1024 overlap.txt overlap.pz > /dev/null 2>&1
+pz --grep aa overlap.pz > out.log 2> /dev/null
+offsets="$(cut -d: -f1 out.log | tr '\n' ' ')"
+if [ "$offsets" = "1022 1023 1024 " ]; then
+    pass "apariciones solapadas reportadas"
+else
+    fail "apariciones solapadas reportadas (obtenido: $offsets)"
+fi
+
+echo "🧪 Fragmentos (--shard y --merge)"
+
+# 12 bloques de 4KB repartidos en 3 fragmentos; other.txt tiene el mismo tamaño y un byte distinto
+seq 1 30000 | head -c 49152 > whole.txt
+cp whole.txt other.txt
+printf 'X' | dd of=other.txt bs=1 seek=30000 conv=notrunc 2> /dev/null
+
+expect_ok "comprimir el fragmento 1/3" pz -c -t 2 -b 4096 --shard 1/3 whole.txt whole.1.pz
+expect_ok "comprimir el fragmento 2/3 (E/S directa)" pz -c -t 2 -b 4096 --direct --shard 2/3 whole.txt whole.2.pz
+expect_ok "comprimir el fragmento 3/3" pz -c -t 2 -b 4096 --shard 3/3 whole.txt whole.3.pz
+expect_ok "unir los fragmentos desordenados" pz --merge whole.pz whole.3.pz whole.1.pz whole.2.pz
+expect_ok "descomprimir el archivo unido" pz -d whole.pz whole.out
+expect_ok "archivo unido idéntico al original" cmp whole.txt whole.out
+
+expect_error "--merge sin un fragmento se rechaza" "Falta el fragmento 2/3" \
+    pz --merge missing.pz whole.1.pz whole.3.pz
+expect_error "--merge con un fragmento repetido se rechaza" "está repetido" \
+    pz --merge dup.pz whole.1.pz whole.2.pz whole.2.pz whole.3.pz
+pz -c -b 4096 --shard 2/3 other.txt other.2.pz > /dev/null 2>&1
+expect_error "--merge con fragmentos de otro archivo del mismo tamaño se rechaza" "archivo distinto" \
+    pz --merge mixed.pz whole.1.pz other.2.pz whole.3.pz
+expect_error "descomprimir un fragmento sin unir se rechaza" "fragmento" pz -d whole.1.pz shard.out
+expect_exit "--grep sobre un fragmento sin unir devuelve 2" 2 pz --grep 1000 whole.1.pz
+
+echo "🧪 Archivos .gz estándar (índice, -d paralelo y --range)"
+
+# ~15MB de texto: varios puntos de acceso (uno cada ~4MB descomprimidos)
+seq 1 2000000 > plain.txt
+gzip -c plain.txt > plain.gz
+expect_ok "construir el índice con --gz-index" pz --gz-index plain.gz
+if [ -f plain.gz.pzi ]; then pass "índice guardado junto al .gz"; else fail "índice guardado junto al .gz"; fi
+expect_ok "descompresión paralela con el índice" pz -d -t 4 plain.gz plain.out
+if grep -q "Usando índice existente" out.log; then
+    pass "se reutiliza el índice guardado"
+else
+    fail "se reutiliza el índice guardado"
+fi
+expect_ok ".gz descomprimido idéntico al original" cmp plain.txt plain.out
+
+touch -d '2001-01-01' plain.gz
+expect_ok "descomprimir con un índice desactualizado" pz -d -t 4 plain.gz stale.out
+if grep -q "desactualizado" out.log; then
+    pass "el índice desactualizado se reconstruye"
+else
+    fail "el índice desactualizado se reconstruye"
+fi
+expect_ok ".gz con índice reconstruido idéntico al original" cmp plain.txt stale.out
+
+expect_ok "extraer un rango con --range" pz -d --range 5000000:4096 plain.gz slice.out
+tail -c +5000001 plain.txt | head -c 4096 > slice.expected
+expect_ok "rango idéntico al del original" cmp slice.expected slice.out
+
+gzip -c needle.txt > member.gz
+cat member.gz member.gz > multi.gz
+expect_error "un .gz de varios miembros se rechaza" "varios miembros" pz --gz-index multi.gz
+
+# Datos aleatorios (bloques stored): un byte cambiado tras indexar solo lo detecta el CRC-32.
+# Se busca un offset que gzip -t reporte como error de CRC (no en una cabecera de bloque)
+head -c 6000000 /dev/urandom > random.bin
+gzip -c random.bin > random.gz
+pz --gz-index random.gz > /dev/null 2>&1
+for at in 3000000 3000100 3000200 3000300 3000400; do
+    cp random.gz corrupt.gz
+    cp random.gz.pzi corrupt.gz.pzi
+    dd if=random.gz bs=1 skip=$at count=1 2> /dev/null | tr '\000-\377' '\377\000-\376' | \
+        dd of=corrupt.gz bs=1 seek=$at conv=notrunc 2> /dev/null
+    touch -r random.gz corrupt.gz
+    if gzip -t corrupt.gz 2>&1 | grep -q "crc error"; then break; fi
+done
+expect_error ".gz corrupto con índice guardado se rechaza" "no coinciden con el trailer gzip" \
+    pz -d -t 4 corrupt.gz corrupt.out
+
+echo "🧪 Daemon residente (--serve)"
+
+# Socket privado en el directorio temporal: no interfiere con un daemon del usuario
+PARZIP_SOCKET="$WORK/parzip.sock"
+export PARZIP_SOCKET
+"$PARZIP" --serve -t 2 > daemon.log 2>&1 &
+daemon_pid=$!
+i=0
+while [ ! -S "$PARZIP_SOCKET" ] && [ $i -lt 50 ]; do sleep 0.1; i=$((i + 1)); done
+
+seq 1 200000 > job1.txt
+head -c 3000000 /dev/urandom > job2.bin
+
+# Dos trabajos concurrentes de compresión y luego de descompresión
+"$PARZIP" -c -t 2 job1.txt job1.pz > job1.log 2>&1 & pid1=$!
+"$PARZIP" -c -t 2 job2.bin job2.pz > job2.log 2>&1 & pid2=$!
+if wait $pid1 && wait $pid2 && grep -q "Usando daemon" job1.log && grep -q "Usando daemon" job2.log; then
+    pass "dos compresiones concurrentes en el daemon"
+else
+    fail "dos compresiones concurrentes en el daemon"; cat job1.log job2.log
+fi
+"$PARZIP" -d job1.pz job1.out > job1.log 2>&1 & pid1=$!
+"$PARZIP" -d job2.pz job2.out > job2.log 2>&1 & pid2=$!
+if wait $pid1 && wait $pid2 && grep -q "Usando daemon" job1.log && grep -q "Usando daemon" job2.log; then
+    pass "dos descompresiones concurrentes en el daemon"
+else
+    fail "dos descompresiones concurrentes en el daemon"; cat job1.log job2.log
+fi
+expect_ok "trabajo 1 del daemon idéntico al original" cmp job1.txt job1.out
+expect_ok "trabajo 2 del daemon idéntico al original" cmp job2.bin job2.out
+
+# El formato es el mismo con y sin daemon
+expect_ok "descomprimir sin daemon un archivo del daemon" pz -d job1.pz job1.local
+expect_ok "archivo del daemon idéntico sin daemon" cmp job1.txt job1.local
+
+kill -TERM $daemon_pid
+wait $daemon_pid
+daemon_pid=""
+if [ ! -e "$PARZIP_SOCKET" ]; then
+    pass "SIGTERM apaga el daemon y borra el socket"
+else
+    fail "SIGTERM apaga el daemon y borra el socket"
+fi
+# El log del daemon se vuelca al terminar (stdout redirigido a archivo)
+if [ "$(grep -c "completado" daemon.log)" -eq 4 ]; then
+    pass "el daemon completó los 4 trabajos"
+else
+    fail "el daemon completó los 4 trabajos"; cat daemon.log
+fi
+unset PARZIP_SOCKET
+
+echo "🧪 E/S directa (--direct)"
+
+# Tamaño que no es múltiplo de 4096: el último bloque se rellena y el ftruncate final lo recorta
+seq 1 200000 | head -c 1000003 > direct.txt
+# check_direct DESCRIPCIÓN: el último comando usó O_DIRECT (tmpfs no lo soporta: solo se avisa)
+check_direct() {
+    if grep -q "O_DIRECT) activada" out.log; then
+        pass "$1"
+    else
+        echo "  ⚠️  O_DIRECT no soportado en $WORK: se probó la E/S con buffer"
+    fi
+}
+
+expect_ok "comprimir con --direct" pz -c --direct -t 4 -b 65536 direct.txt direct.pz
+check_direct "O_DIRECT activo al comprimir"
+expect_ok "descomprimir con --direct" pz -d --direct -t 4 direct.pz direct.out
+check_direct "O_DIRECT activo al descomprimir"
+expect_ok "ida y vuelta con --direct idéntica al original" cmp direct.txt direct.out
+
+# Archivo comprimido sin --direct: payloads sin alinear, leídos con una ventana alineada
+pz -c -t 4 -b 65536 direct.txt buffered.pz > /dev/null 2>&1
+expect_ok "descomprimir con --direct un archivo con payloads sin alinear" pz -d --direct -t 4 buffered.pz buffered.out
+check_direct "O_DIRECT activo con payloads sin alinear"
+expect_ok "payloads sin alinear idénticos al original" cmp direct.txt buffered.out
+
+# Bloques no múltiplos de 4096: al comprimir es un error, al descomprimir se usa E/S con buffer
+expect_error "--direct con -b 1024 al comprimir se rechaza" "múltiplo de 4096" \
+    pz -c --direct -b 1024 direct.txt odd_direct.pz
+pz -c -b 1024 direct.txt odd.pz > /dev/null 2>&1
+expect_ok "descomprimir con --direct bloques de 1024 bytes" pz -d --direct odd.pz odd.out
+if grep -q "usando E/S con buffer" out.log; then
+    pass "bloques sin alinear usan E/S con buffer"
+else
+    fail "bloques sin alinear usan E/S con buffer"
+fi
+expect_ok "bloques de 1024 bytes idénticos al original" cmp direct.txt odd.out
+
+echo "🧪 Archivos dispersos y bloques de ceros"
+
+# Imagen dispersa de 64MB con datos solo en dos bloques de 64KB (el 0 y el 640)
+truncate -s 64M sparse.img
+printf 'CABECERA' | dd of=sparse.img conv=notrunc 2> /dev/null
+printf 'COLA' | dd of=sparse.img bs=1 seek=41943040 conv=notrunc 2> /dev/null
+expect_ok "comprimir una imagen dispersa" pz -c -t 4 -b 65536 sparse.img sparse.pz
+if grep -q "Bloques en huecos del archivo: 1022" out.log; then
+    pass "1022 de 1024 bloques en huecos sin leer"
+else
+    fail "1022 de 1024 bloques en huecos sin leer"; grep "huecos" out.log
+fi
+expect_ok "descomprimir la imagen dispersa" pz -d -t 4 sparse.pz sparse.out
+expect_ok "imagen dispersa idéntica a la original" cmp sparse.img sparse.out
+allocated_kb="$(du -k sparse.out | cut -f1)"
+if [ "$allocated_kb" -lt 1024 ]; then
+    pass "la imagen restaurada sigue dispersa (${allocated_kb}KB asignados de 65536KB)"
+else
+    fail "la imagen restaurada sigue dispersa (${allocated_kb}KB asignados de 65536KB)"
+fi
+
+# Ceros escritos de verdad (sin huecos): los detecta la comparación de cada bloque leído
+dd if=/dev/zero of=zeros.bin bs=65536 count=4 2> /dev/null
+expect_ok "comprimir un archivo de ceros" pz -c -t 2 -b 65536 zeros.bin zeros.pz
+if grep -q "Bloques de ceros: 4 de 4" out.log && ! grep -q "huecos" out.log; then
+    pass "ceros detectados al leer los bloques (no como huecos)"
+else
+    fail "ceros detectados al leer los bloques (no como huecos)"; grep "ceros\|huecos" out.log
+fi
+zero_ok=1
+for i in 0 1 2 3; do
+    flags="$(block_flags zeros.pz $i)"
+    if [ $((flags & 1)) -ne 1 ] || [ "$(block_csize zeros.pz $i)" -ne 0 ]; then zero_ok=0; fi
+done
+# Header (32) + 4 block_info_t (24) + 4 digests (32): sin ningún payload
+if [ $zero_ok -eq 1 ] && [ "$(wc -c < zeros.pz)" -eq 256 ]; then
+    pass "bloques de ceros con BLOCK_FLAG_ZERO y sin payload"
+else
+    fail "bloques de ceros con BLOCK_FLAG_ZERO y sin payload"
+fi
+expect_ok "descomprimir el archivo de ceros" pz -d zeros.pz zeros.out
+expect_ok "archivo de ceros idéntico al original" cmp zeros.bin zeros.out
+
+echo "🧪 Nivel adaptativo (--target-rate)"
+
+# Corpus mixto: texto y datos aleatorios en bloques de 64KB
+seq 1 200000 > rate.bin
+head -c 1048576 /dev/urandom >> rate.bin
+expect_ok "comprimir con --target-rate" pz -c -t 4 -b 65536 --target-rate 50 rate.bin rate.pz
+expect_ok "descomprimir lo comprimido con --target-rate" pz -d rate.pz rate.out
+expect_ok "--target-rate idéntico al original" cmp rate.bin rate.out
+num_blocks="$(read_uint rate.pz 8 4)"
+levels_ok=1
+i=0
+while [ $i -lt "$num_blocks" ]; do
+    if [ $(($(block_flags rate.pz $i) & 1)) -eq 0 ] && [ "$(block_level rate.pz $i)" -gt 9 ]; then levels_ok=0; fi
+    i=$((i + 1))
+done
+if [ "$num_blocks" -gt 1 ] && [ $levels_ok -eq 1 ]; then
+    pass "nivel entre 0 y 9 en los $num_blocks bloques"
+else
+    fail "nivel entre 0 y 9 en los $num_blocks bloques"
+fi
+
+if [ "$FAILED" -ne 0 ]; then
+    echo "❌ Algunas pruebas fallaron"
+    exit 1
+fi
+echo "✅ Todas las pruebas de integración pasaron"
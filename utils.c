@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include "utils.h"
 #include "compressor.h"
 #include <stdio.h>
@@ -5,6 +6,16 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 // Funciones específicas para el formato ParZip
 int write_parzip_header(FILE *fp, const parzip_header_t *header) {
@@ -31,6 +42,28 @@ int read_parzip_block_info(FILE *fp, block_info_t *info) {
     return (read == 1) ? 0 : -1;
 }
 
+// Leer la tabla de bloques y, si el archivo la tiene, la tabla de hashes
+int read_parzip_tables(FILE *fp, const parzip_header_t *header, block_info_t *block_infos, block_digest_t *block_hashes) {
+    if (!fp || !header || !block_infos) return -1;
+    if (fseeko(fp, sizeof(parzip_header_t), SEEK_SET) != 0) return -1;
+    for (uint32_t i = 0; i < header->num_blocks; i++) {
+        if (read_parzip_block_info(fp, &block_infos[i]) != 0) return -1;
+    }
+    if (block_hashes && (parzip_flags(header) & PARZIP_FLAG_BLOCK_HASHES)) {
+        if (fread(block_hashes, sizeof(block_digest_t), header->num_blocks, fp) != header->num_blocks) return -1;
+    }
+    return 0;
+}
+
+// Leer el registro de un fragmento (justo antes del inicio de los datos)
+int read_parzip_shard_info(FILE *fp, const parzip_header_t *header, parzip_shard_info_t *info) {
+    if (!fp || !header || !info || !(parzip_flags(header) & PARZIP_FLAG_PARTIAL)) return -1;
+    if (fseeko(fp, parzip_data_offset(header) - sizeof(parzip_shard_info_t), SEEK_SET) != 0) return -1;
+    if (fread(info, sizeof(parzip_shard_info_t), 1, fp) != 1) return -1;
+    if (info->shard_count == 0 || info->shard_index < 1 || info->shard_index > info->shard_count) return -1;
+    return 0;
+}
+
 // Funciones de E/O genéricas para compatibilidad
 int write_header(FILE *fp, const void *header) {
     return write_parzip_header(fp, (const parzip_header_t*)header);
@@ -48,6 +81,254 @@ int read_block_info(FILE *fp, void *info) {
     return read_parzip_block_info(fp, (block_info_t*)info);
 }
 
+// Lectura posicional completa (reintenta lecturas parciales); devuelve bytes leídos o -1
+ssize_t pread_full(int fd, void *buf, size_t count, off_t offset) {
+    size_t done = 0;
+    while (done < count) {
+        ssize_t n = pread(fd, (char*)buf + done, count - done, offset + done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) break; // EOF
+        done += n;
+    }
+    return done;
+}
+
+// Escritura posicional completa; devuelve 0 si se escribieron todos los bytes
+int pwrite_full(int fd, const void *buf, size_t count, off_t offset) {
+    size_t done = 0;
+    while (done < count) {
+        ssize_t n = pwrite(fd, (const char*)buf + done, count - done, offset + done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        done += n;
+    }
+    return 0;
+}
+
+// Copiar una región entre descriptores sin pasar por espacio de usuario (copy_file_range);
+// si el kernel o el sistema de archivos no lo permiten, copia con pread/pwrite
+int copy_file_region(int in_fd, off_t in_offset, int out_fd, off_t out_offset, size_t count) {
+    while (count > 0) {
+        ssize_t n = copy_file_range(in_fd, &in_offset, out_fd, &out_offset, count, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        count -= n;
+    }
+    if (count == 0) return 0;
+    
+    size_t chunk = count < 1048576 ? count : 1048576;
+    unsigned char *buffer = malloc(chunk);
+    if (!buffer) return -1;
+    while (count > 0) {
+        size_t len = count < chunk ? count : chunk;
+        if (pread_full(in_fd, buffer, len, in_offset) != (ssize_t)len ||
+            pwrite_full(out_fd, buffer, len, out_offset) != 0) {
+            free(buffer);
+            return -1;
+        }
+        in_offset += len;
+        out_offset += len;
+        count -= len;
+    }
+    free(buffer);
+    return 0;
+}
+
+// Buffer alineado a DIRECT_IO_ALIGN (liberar con free)
+void* alloc_aligned(size_t size) {
+    void *ptr = NULL;
+    if (posix_memalign(&ptr, DIRECT_IO_ALIGN, size ? size : DIRECT_IO_ALIGN) != 0) return NULL;
+    return ptr;
+}
+
+// Lectura con O_DIRECT: una lectura corta no alineada indica fin de archivo
+ssize_t pread_direct(int fd, void *buf, size_t count, off_t offset) {
+    size_t done = 0;
+    while (done < count) {
+        ssize_t n = pread(fd, (char*)buf + done, count - done, offset + done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        done += n;
+        if (n == 0 || n % DIRECT_IO_ALIGN != 0) break; // EOF
+    }
+    return done;
+}
+
+// Abrir con O_DIRECT; errno == EINVAL si el sistema de archivos no lo soporta
+int open_direct(const char *filename, int flags) {
+    return open(filename, flags | O_DIRECT | O_CLOEXEC, 0644);
+}
+
+// Devuelve 1 si los 'len' bytes del buffer son cero
+int is_zero_block(const unsigned char *buf, size_t len) {
+    size_t i = 0;
+#ifdef __SSE2__
+    // OR de 64 bytes por iteración y una sola comparación contra cero
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 64 <= len; i += 64) {
+        __m128i acc = _mm_or_si128(
+            _mm_or_si128(_mm_loadu_si128((const __m128i*)(buf + i)), _mm_loadu_si128((const __m128i*)(buf + i + 16))),
+            _mm_or_si128(_mm_loadu_si128((const __m128i*)(buf + i + 32)), _mm_loadu_si128((const __m128i*)(buf + i + 48))));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(acc, zero)) != 0xFFFF) return 0;
+    }
+#else
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, buf + i, sizeof(word));
+        if (word) return 0;
+    }
+#endif
+    for (; i < len; i++) {
+        if (buf[i]) return 0;
+    }
+    return 1;
+}
+
+// SHA-256 (FIPS 180-4): identidad fuerte del contenido de cada bloque
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_compress(uint32_t state[8], const unsigned char *chunk) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)chunk[4 * i] << 24) | ((uint32_t)chunk[4 * i + 1] << 16) |
+               ((uint32_t)chunk[4 * i + 2] << 8) | (uint32_t)chunk[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR32(w[i - 15], 7) ^ ROTR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR32(w[i - 2], 17) ^ ROTR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+        uint32_t t2 = (ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+static void sha256_blocks_scalar(uint32_t state[8], const unsigned char *data, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        sha256_compress(state, data + 64 * i);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// SHA-256 con las instrucciones SHA-NI: 4 rondas por par de sha256rnds2 y el
+// message schedule con sha256msg1/sha256msg2 (mismo resultado que la versión escalar)
+__attribute__((target("sha,sse4.1")))
+static void sha256_blocks_shani(uint32_t state[8], const unsigned char *data, size_t count) {
+    const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    
+    // El estado se reordena a ABEF/CDGH, el formato que usa sha256rnds2
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[0]), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[4]), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+    
+    for (size_t n = 0; n < count; n++, data += 64) {
+        __m128i abef = state0, cdgh = state1;
+        __m128i w[4];
+        for (int i = 0; i < 4; i++) {
+            w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16 * i)), byte_swap);
+        }
+        
+        for (int i = 0; i < 16; i++) {
+            __m128i msg = _mm_add_epi32(w[i & 3], _mm_loadu_si128((const __m128i*)&sha256_k[4 * i]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+            
+            // W[i+4] reemplaza a W[i] en el mismo hueco
+            if (i < 12) {
+                __m128i next = _mm_add_epi32(_mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]),
+                                             _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4));
+                w[i & 3] = _mm_sha256msg2_epu32(next, w[(i + 3) & 3]);
+            }
+        }
+        
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+    
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    _mm_storeu_si128((__m128i*)&state[0], _mm_blend_epi16(tmp, state1, 0xF0));
+    _mm_storeu_si128((__m128i*)&state[4], _mm_alignr_epi8(state1, tmp, 8));
+}
+#endif
+
+// Implementación elegida una sola vez según la CPU (SHA-NI si está disponible)
+static void (*sha256_blocks)(uint32_t state[8], const unsigned char *data, size_t count) = sha256_blocks_scalar;
+static pthread_once_t sha256_once = PTHREAD_ONCE_INIT;
+
+static void sha256_select(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    int has_sse41 = __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_1) && (ecx & bit_SSSE3);
+    int has_sha = __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_SHA);
+    if (has_sse41 && has_sha) sha256_blocks = sha256_blocks_shani;
+#endif
+}
+
+void block_digest(const unsigned char *buf, size_t len, block_digest_t *digest) {
+    uint32_t state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    unsigned char tail[128];
+    size_t full = len & ~(size_t)63;
+    
+    pthread_once(&sha256_once, sha256_select);
+    sha256_blocks(state, buf, full / 64);
+    
+    // Último trozo con relleno: 0x80, ceros y la longitud en bits (big-endian)
+    size_t rest = len - full;
+    size_t tail_size = rest < 56 ? 64 : 128;
+    uint64_t bits = (uint64_t)len * 8;
+    memset(tail, 0, sizeof(tail));
+    memcpy(tail, buf + full, rest);
+    tail[rest] = 0x80;
+    for (int i = 0; i < 8; i++) {
+        tail[tail_size - 1 - i] = (unsigned char)(bits >> (8 * i));
+    }
+    sha256_blocks(state, tail, tail_size / 64);
+    
+    for (int i = 0; i < 8; i++) {
+        digest->bytes[4 * i] = (unsigned char)(state[i] >> 24);
+        digest->bytes[4 * i + 1] = (unsigned char)(state[i] >> 16);
+        digest->bytes[4 * i + 2] = (unsigned char)(state[i] >> 8);
+        digest->bytes[4 * i + 3] = (unsigned char)state[i];
+    }
+}
+
+// Comprobar el contenido de un bloque contra su digest (1 si coincide)
+int block_digest_matches(const unsigned char *buf, size_t len, const block_digest_t *expected) {
+    block_digest_t digest;
+    block_digest(buf, len, &digest);
+    return memcmp(&digest, expected, sizeof(digest)) == 0;
+}
+
 // Funciones de utilidad para archivos
 long get_file_size(const char *filename) {
     struct stat st;
@@ -3,6 +3,8 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <sys/types.h>
+#include "compressor.h"
 
 // Funciones de utilidad para E/O de archivos (genéricas)
 int write_header(FILE *fp, const void *header);
@@ -10,6 +12,23 @@ int read_header(FILE *fp, void *header);
 int write_block_info(FILE *fp, const void *info);
 int read_block_info(FILE *fp, void *info);
 
+// E/O posicional sobre descriptores (compartidos entre hilos)
+ssize_t pread_full(int fd, void *buf, size_t count, off_t offset);
+int pwrite_full(int fd, const void *buf, size_t count, off_t offset);
+int copy_file_region(int in_fd, off_t in_offset, int out_fd, off_t out_offset, size_t count);
+
+// E/O directa (O_DIRECT)
+void* alloc_aligned(size_t size);
+ssize_t pread_direct(int fd, void *buf, size_t count, off_t offset);
+int open_direct(const char *filename, int flags);
+
+// Detección de bloques de ceros (vectorizada con SSE2 cuando está disponible)
+int is_zero_block(const unsigned char *buf, size_t len);
+
+// Digest SHA-256 del contenido de un bloque
+void block_digest(const unsigned char *buf, size_t len, block_digest_t *digest);
+int block_digest_matches(const unsigned char *buf, size_t len, const block_digest_t *expected);
+
 // Funciones de utilidad para archivos
 long get_file_size(const char *filename);
 int file_exists(const char *filename);